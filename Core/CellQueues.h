@@ -0,0 +1,213 @@
+/**
+* @file CellQueues.h
+* @brief Priority queues of cells used by LazyMole
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_CELLQUEUES_H
+#define LMA_CELLQUEUES_H
+
+#include <cstddef>
+#include <vector>
+#include <limits>
+#include <boost/heap/fibonacci_heap.hpp>
+
+namespace mla {
+
+    /**
+     * Exact queue: Fibonacci heap with one handle per cell.
+     */
+    class HeapQueue {
+
+    private:
+
+        struct CellElement {
+
+            double res;
+            size_t cell;
+
+            CellElement(double r, size_t c)
+                    : res(r), cell(c) {}
+
+            inline bool operator<(CellElement const & rhs) const { return res < rhs.res; }
+        };
+
+        // The heap is a max-heap, resistances are stored with the opposite sign
+        typedef typename boost::heap::fibonacci_heap<CellElement> Heap;
+        typedef typename boost::heap::fibonacci_heap<CellElement>::handle_type HandleType;
+
+        Heap heap;
+
+        std::vector<HandleType> handles;
+
+    public:
+
+        HeapQueue(const size_t nCells) : handles(nCells) {};
+
+        bool empty() const {
+            return heap.empty();
+        };
+
+        size_t topCell() const {
+            return heap.top().cell;
+        };
+
+        double topRes() const {
+            return -heap.top().res;
+        };
+
+        void pop() {
+            heap.pop();
+        };
+
+        void push(const size_t cell, const double res) {
+            handles[cell] = heap.push(CellElement(-res, cell));
+        };
+
+        // res must be smaller than the current key of the cell
+        void decrease(const size_t cell, const double res) {
+            heap.increase(handles[cell], CellElement(-res, cell));
+        };
+
+        // Empty the queue, keeping the handles: a handle is read only after its cell is pushed again
+        void clear() {
+            heap.clear();
+        };
+
+        double key(const size_t cell) const {
+            return -(*handles[cell]).res;
+        };
+
+    };
+
+
+    /**
+     * Approximate queue: circular array of buckets of fixed width (Dial's algorithm).
+     * Cells in the same bucket are popped in arbitrary order. Push and decrease
+     * are O(1) using an intrusive doubly linked list per bucket.
+     *
+     * The keys in the queue must always lie within nBuckets*width from the
+     * key of the last popped cell, i.e. width*(nBuckets-1) must not be smaller
+     * than the largest resistance between neighbors.
+     */
+    class BucketQueue {
+
+    private:
+
+        static constexpr size_t NIL = std::numeric_limits<size_t>::max();
+
+        double width;
+
+        std::vector<size_t> heads;
+
+        std::vector<size_t> next;
+
+        std::vector<size_t> prev;
+
+        std::vector<double> keys;
+
+        mutable size_t current;
+
+        size_t count;
+
+        size_t bucket(const double res) const {
+            return static_cast<size_t>(res / width);
+        }
+
+        void link(const size_t cell) {
+            const size_t b = bucket(keys[cell]) % heads.size();
+            next[cell] = heads[b];
+            prev[cell] = NIL;
+            if (heads[b] != NIL)
+                prev[heads[b]] = cell;
+            heads[b] = cell;
+        }
+
+        void unlink(const size_t cell) {
+            if (prev[cell] != NIL)
+                next[prev[cell]] = next[cell];
+            else
+                heads[bucket(keys[cell]) % heads.size()] = next[cell];
+            if (next[cell] != NIL)
+                prev[next[cell]] = prev[cell];
+        }
+
+        // Move to the first non-empty bucket
+        void advance() const {
+            while (heads[current % heads.size()] == NIL)
+                current++;
+        }
+
+    public:
+
+        BucketQueue(const size_t nCells, const double bucketWidth, const size_t nBuckets) :
+                width(bucketWidth), heads(nBuckets, std::numeric_limits<size_t>::max()),
+                next(nCells), prev(nCells), keys(nCells), current(0), count(0) {};
+
+        bool empty() const {
+            return count == 0;
+        };
+
+        size_t topCell() const {
+            advance();
+            return heads[current % heads.size()];
+        };
+
+        double topRes() const {
+            return keys[topCell()];
+        };
+
+        void pop() {
+            const size_t cell = topCell();
+            unlink(cell);
+            count--;
+        };
+
+        // The first key does not need to be in the first bucket (e.g. with a potential or when
+        // the queue is rebuilt from a checkpoint)
+        void push(const size_t cell, const double res) {
+            keys[cell] = res;
+            link(cell);
+            if (count == 0 || bucket(res) < current)
+                current = bucket(res);
+            count++;
+        };
+
+        // res must be smaller than the current key of the cell
+        void decrease(const size_t cell, const double res) {
+            if (bucket(res) != bucket(keys[cell])) {
+                unlink(cell);
+                keys[cell] = res;
+                link(cell);
+            } else {
+                keys[cell] = res;
+            }
+        };
+
+        double key(const size_t cell) const {
+            return keys[cell];
+        };
+
+    };
+
+}
+
+
+#endif //LMA_CELLQUEUES_H
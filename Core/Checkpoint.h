@@ -0,0 +1,206 @@
+/**
+* @file Checkpoint.h
+* @brief Incremental journal of the state of LazyMole used to resume long runs
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_CHECKPOINT_H
+#define LMA_CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <functional>
+#include <stdexcept>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace mla {
+
+    // State of a cell (compact index) at the time of a checkpoint
+    struct CheckpointRecord {
+        uint64_t id;
+        uint64_t status;
+        double res;
+        uint64_t previous;
+    };
+
+    /**
+     * File layout (native endianness, 64 bit words so that the file can be mapped in memory):
+     *   header    magic, version, key, number of active cells
+     *   batches   number of records n, n records, n xor magic (commit word)
+     * Each checkpoint appends a batch with the cells changed since the previous one.
+     * A batch interrupted while writing has no valid commit word and is ignored.
+     */
+    class Checkpoint {
+
+    public:
+
+        Checkpoint(const std::string& fileName, const uint64_t key, const size_t nActive) :
+                fileName(fileName), key(key), nActive(nActive), isPending(false) {};
+
+        ~Checkpoint() {
+            try {
+                wait();
+            } catch (...) {
+            }
+        };
+
+        const std::string& file() const {
+            return fileName;
+        };
+
+        // Start a new journal. It is written next to the file and replaces it once
+        // its first batch is complete, so that the previous journal is never lost.
+        void create() {
+            wait();
+            outStream.close();
+            outStream.open(fileName + ".new", std::ios::binary | std::ios::trunc);
+            if (!outStream) {
+                throw std::runtime_error("ERROR: cannot open the file " + fileName + ".new");
+            }
+            isPending = true;
+            const uint64_t header[HEADER_WORDS] = {MAGIC, VERSION, key, static_cast<uint64_t>(nActive)};
+            outStream.write(reinterpret_cast<const char*>(header), sizeof(header));
+            outStream.flush();
+        };
+
+        // Append a batch on a background thread (waits for the previous batch first)
+        void write(std::vector<CheckpointRecord>&& records) {
+            wait();
+            batch.swap(records);
+            records.clear();
+            writer = std::thread([this]() {
+                const uint64_t n = batch.size();
+                const uint64_t commit = n ^ MAGIC;
+                outStream.write(reinterpret_cast<const char*>(&n), sizeof(uint64_t));
+                outStream.write(reinterpret_cast<const char*>(batch.data()), n * sizeof(CheckpointRecord));
+                outStream.write(reinterpret_cast<const char*>(&commit), sizeof(uint64_t));
+                outStream.flush();
+            });
+        };
+
+        // Wait for the last batch to be written
+        void wait() {
+            if (!writer.joinable())
+                return;
+            writer.join();
+            if (!outStream) {
+                throw std::runtime_error("ERROR: cannot write the file " + fileName);
+            }
+            if (isPending) {
+                if (std::rename((fileName + ".new").c_str(), fileName.c_str()) != 0) {
+                    throw std::runtime_error("ERROR: cannot replace the file " + fileName);
+                }
+                isPending = false;
+            }
+        };
+
+        // Apply the records of the complete batches in order, false if the file is missing
+        // or was written for different inputs
+        bool replay(const std::function<void(const CheckpointRecord&)>& apply) const {
+#ifndef _WIN32
+            const int fd = open(fileName.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat info;
+            if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < HEADER_SIZE) {
+                close(fd);
+                return false;
+            }
+            const size_t size = static_cast<size_t>(info.st_size);
+            void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (data == MAP_FAILED)
+                return false;
+            const bool isValid = replay(static_cast<const char*>(data), size, apply);
+            munmap(data, size);
+            return isValid;
+#else
+            std::ifstream inStream(fileName, std::ios::binary);
+            if (!inStream)
+                return false;
+            std::vector<char> data((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+            return replay(data.data(), data.size(), apply);
+#endif
+        };
+
+    private:
+
+        bool replay(const char* data, const size_t size,
+                    const std::function<void(const CheckpointRecord&)>& apply) const {
+            if (size < HEADER_SIZE)
+                return false;
+            uint64_t header[HEADER_WORDS];
+            std::memcpy(header, data, HEADER_SIZE);
+            if (header[0] != MAGIC || header[1] != VERSION || header[2] != key || header[3] != nActive)
+                return false;
+
+            size_t offset = HEADER_SIZE;
+            CheckpointRecord record;
+            while (offset + sizeof(uint64_t) <= size) {
+                uint64_t n, commit;
+                std::memcpy(&n, data + offset, sizeof(uint64_t));
+                const size_t end = offset + sizeof(uint64_t) + n * sizeof(CheckpointRecord);
+                if (n > nActive || end + sizeof(uint64_t) > size)
+                    break;
+                std::memcpy(&commit, data + end, sizeof(uint64_t));
+                if (commit != (n ^ MAGIC))
+                    break;
+                for (size_t i = 0; i < n; i++) {
+                    std::memcpy(&record, data + offset + sizeof(uint64_t) + i * sizeof(CheckpointRecord),
+                                sizeof(CheckpointRecord));
+                    if (record.id < nActive)
+                        apply(record);
+                }
+                offset = end + sizeof(uint64_t);
+            }
+            return true;
+        };
+
+        static const uint64_t MAGIC = 0x314b434548434d4cULL; // "LMCHECK1"
+        static const uint64_t VERSION = 1;
+        static const size_t HEADER_WORDS = 4;
+        static const size_t HEADER_SIZE = HEADER_WORDS * sizeof(uint64_t);
+
+        std::string fileName;
+        uint64_t key;
+        size_t nActive;
+
+        std::ofstream outStream;
+        bool isPending;
+        std::vector<CheckpointRecord> batch;
+        std::thread writer;
+
+    };
+}
+
+
+#endif //LMA_CHECKPOINT_H
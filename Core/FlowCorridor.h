@@ -0,0 +1,163 @@
+/**
+* @file FlowCorridor.h
+* @brief Cells whose best source-to-target path through the cell is close
+*        to the minimum hydraulic resistance
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_FLOWCORRIDOR_H
+#define LMA_FLOWCORRIDOR_H
+
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+#include <CellField.h>
+#include <ActiveCellField.h>
+#include "LazyMole.h"
+
+namespace mla {
+
+    /**
+     * The resistance between neighbors is symmetric, so the resistance from a cell to the
+     * closest target is the map of a search started from the targets. The best path from the
+     * sources to the targets through a cell has the sum of the two maps as resistance; the
+     * corridor collects the cells where this sum is within (1+tolerance) of the MHR.
+     */
+    class FlowCorridor {
+
+    public:
+
+        FlowCorridor(Grid* grid, CellField<double>& field,
+                     const std::vector<size_t>& sourceIds, const std::vector<size_t>& targetIds,
+                     const ActiveCells* active = nullptr) :
+                gridPtr(grid), field(field), sources(sourceIds), targets(targetIds),
+                activePtr(active ? active : &allCells), allCells(grid), tolerance(0.05),
+                minRes(std::numeric_limits<double>::max()), nCells(0) {};
+
+        // Relative tolerance on the resistance of the paths through the corridor cells
+        void setTolerance(const double tol) {
+            if (tol < 0.)
+                throw std::runtime_error("ERROR: the corridor tolerance cannot be negative");
+            tolerance = tol;
+        }
+
+        // Run the searches from the sources and from the targets on two threads.
+        // Returns the solver started from the sources (resistance map and path).
+        LazyMole& run() {
+            std::exception_ptr forwardError;
+            std::thread forwardThread([this, &forwardError]() {
+                try {
+                    forwardMole.reset(new LazyMole(gridPtr, field, sources, activePtr));
+                    forwardMole->run();
+                } catch (...) {
+                    forwardError = std::current_exception();
+                }
+            });
+            std::exception_ptr backwardError;
+            try {
+                backwardMole.reset(new LazyMole(gridPtr, field, targets, activePtr));
+                backwardMole->run();
+            } catch (...) {
+                backwardError = std::current_exception();
+            }
+            forwardThread.join();
+            if (forwardError)
+                std::rethrow_exception(forwardError);
+            if (backwardError)
+                std::rethrow_exception(backwardError);
+
+            auto forwardRes = forwardMole->resistance();
+            auto backwardRes = backwardMole->resistance();
+
+            minRes = std::numeric_limits<double>::max();
+            for (auto cell : targets) {
+                minRes = std::min(minRes, forwardRes->getFromCell(cell));
+            }
+
+            const double INF = std::numeric_limits<double>::max();
+            slackField.reset(new ActiveCellField<double>(activePtr, INF, INF));
+            maskField.reset(new ActiveCellField<int>(activePtr, 0, 0));
+            nCells = 0;
+            if (minRes == INF)
+                return *forwardMole;
+
+            const double maxRes = (1. + tolerance) * minRes;
+            for (size_t id = 0; id < activePtr->size(); id++) {
+                const double fRes = (*forwardRes)[id];
+                const double bRes = (*backwardRes)[id];
+                if (fRes == INF || bRes == INF)
+                    continue;
+                const double total = fRes + bRes;
+                (*slackField)[id] = std::max(total - minRes, 0.);
+                if (total <= maxRes) {
+                    (*maskField)[id] = 1;
+                    nCells++;
+                }
+            }
+            return *forwardMole;
+        }
+
+        // Minimum hydraulic resistance between the sources and the targets
+        double resistance() const {
+            return minRes;
+        }
+
+        // Resistance of the best path through each cell minus the MHR
+        const ActiveCellField<double>& slack() const {
+            return *slackField;
+        }
+
+        // 1 for the cells of the corridor, 0 otherwise
+        const ActiveCellField<int>& mask() const {
+            return *maskField;
+        }
+
+        size_t size() const {
+            return nCells;
+        }
+
+    private:
+
+        Grid* gridPtr;
+        CellField<double>& field;
+        std::vector<size_t> sources;
+        std::vector<size_t> targets;
+        const ActiveCells* activePtr;
+        ActiveCells allCells;
+
+        double tolerance;
+        double minRes;
+        size_t nCells;
+
+        std::unique_ptr<LazyMole> forwardMole;
+        std::unique_ptr<LazyMole> backwardMole;
+        std::unique_ptr<ActiveCellField<double>> slackField;
+        std::unique_ptr<ActiveCellField<int>> maskField;
+
+    };
+
+}
+
+
+#endif //LMA_FLOWCORRIDOR_H
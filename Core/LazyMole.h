@@ -28,14 +28,36 @@
 #include <cstddef>
 #include <iostream>
 #include <CellField.h>
-#include <boost/heap/fibonacci_heap.hpp>
+#include <ActiveCellField.h>
+#include <CellQueues.h>
+#include <Checkpoint.h>
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <unordered_map>
 #include <limits>
 #include <cmath>
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <stdexcept>
 
 namespace mla {
 
+    // State of a run, reported every few settled cells (see LazyMole::setProgress)
+    struct RunProgress {
+        size_t settled;     // Cells settled by the run so far
+        size_t total;       // Active cells
+        double resistance;  // Resistance of the last settled cell, i.e. of the front of the search
+        double elapsed;     // Seconds since the start of the run
+        double eta;         // Seconds left to settle all the cells at the current rate
+                            // (an upper bound when the run stops at the targets or at a resistance)
+    };
+
     class LazyMole {
 
+        friend class ResultCache;
+
     private:
 
         enum Label {
@@ -44,35 +66,92 @@ namespace mla {
             SCANNED
         };
 
-        struct CellElement {
+        Grid* gridPtr;
 
-            double res;
-            size_t cell;
+        // All the per-cell state below is indexed by the compact index of the active cells
+        ActiveCells allCells;
 
-            CellElement(double r, size_t c)
-                    : res(r), cell(c) {}
+        const ActiveCells* activePtr;
 
-            inline bool operator<(CellElement const & rhs) const { return res < rhs.res; }
-        };
+        ActiveCellField<Label> status;
 
-        typedef typename boost::heap::fibonacci_heap<CellElement> Heap;
-        typedef typename boost::heap::fibonacci_heap<CellElement>::handle_type HandleType;
+        ActiveCellField<size_t> previous;
 
-        Heap heap;
+        ActiveCellField<double> smallestRes;
 
-        CellField<Label> status;
+        ActiveCellField<double> field;
 
-        CellField<HandleType> cellElementHandles;
+        std::vector<size_t> sources;
 
-        CellField<size_t> previous;
+        bool isReady;
 
-        CellField<double> smallestRes;
+        // Maximum relative error allowed (0 for the exact algorithm)
+        double epsilon;
 
-        Grid* gridPtr;
+        double bound;
 
-        CellField<double> field;
+        // Termination criteria
+        std::vector<bool> isTarget;
 
-        bool isReady;
+        std::vector<size_t> targets;
+
+        size_t nTargetsLeft;
+
+        double maxRes;
+
+        // Lower bound of the resistance from a cell to the closest target (A* search)
+        std::function<double(size_t)> potential;
+
+        std::function<void(size_t)> fieldLoader;
+
+        // Checkpoints: the cells changed since the last checkpoint are saved every
+        // checkpointPops settled cells or every checkpointSeconds
+        std::unique_ptr<Checkpoint> checkpoint;
+
+        size_t checkpointPops;
+
+        double checkpointSeconds;
+
+        std::vector<char> isDirty;
+
+        std::vector<size_t> dirty;
+
+        bool isResumed;
+
+        // Cells visited since the last reset, so that the next reset restores only these. Not valid
+        // after a resume or a cached result, which change cells outside the search.
+        std::vector<size_t> touched;
+
+        bool isTouchedValid;
+
+        // Kept between the runs of the exact algorithm
+        std::unique_ptr<HeapQueue> heapQueue;
+
+        // Attributes of the least resistance path of each cell, carried along the predecessor tree
+        struct PathAttributes {
+            PathAttributes(const ActiveCells* active, const double inf, const size_t empty) :
+                    length(active, inf, inf), steps(active, empty, empty),
+                    minK(active, inf, inf), maxK(active, inf, inf) {};
+
+            ActiveCellField<double> length;
+            ActiveCellField<size_t> steps;
+            ActiveCellField<double> minK;
+            ActiveCellField<double> maxK;
+        };
+
+        std::unique_ptr<PathAttributes> attributes;
+
+        // True if the attributes match the predecessor tree of the last run
+        bool isAccumulated;
+
+        // Progress and cancellation, sampled every samplePops settled cells
+        std::function<void(const RunProgress&)> progress;
+
+        const std::atomic<bool>* cancelToken;
+
+        size_t samplePops;
+
+        bool isCancelled;
 
         const double INF = std::numeric_limits<double>::max();
 
@@ -80,73 +159,251 @@ namespace mla {
 
     public:
 
-        LazyMole(Grid* gridPtr, CellField<double>& field, const std::vector<size_t> cellIds) :
-                gridPtr(gridPtr), field(field),
-                status(gridPtr, UNVISITED), previous(gridPtr, std::numeric_limits<size_t>::max()),
-                smallestRes(gridPtr, std::numeric_limits<double>::max()),
-                cellElementHandles(gridPtr, HandleType()) {
-            for(auto i = 0; i < cellIds.size(); i++) {
-                cellElementHandles[cellIds[i]] = heap.push(CellElement(0., cellIds[i]));
-                status[cellIds[i]] = VISITED;
+        LazyMole(Grid* gridPtr, CellField<double>& field, const std::vector<size_t> cellIds,
+                 const ActiveCells* active = nullptr) :
+                gridPtr(gridPtr), allCells(gridPtr), activePtr(active ? active : &allCells),
+                status(activePtr, UNVISITED),
+                previous(activePtr, std::numeric_limits<size_t>::max()),
+                smallestRes(activePtr, std::numeric_limits<double>::max(), std::numeric_limits<double>::max()),
+                field(activePtr), epsilon(0.), bound(0.),
+                nTargetsLeft(0), maxRes(std::numeric_limits<double>::max()),
+                checkpointPops(0), checkpointSeconds(0.), isResumed(false), isTouchedValid(true), isAccumulated(false),
+                cancelToken(nullptr), samplePops(65536), isCancelled(false) {
+            for (size_t i = 0; i < activePtr->size(); i++) {
+                this->field[i] = field.getFromCell(activePtr->cell(i));
             }
-            isReady = false;
+            setSources(cellIds);
+        }
+
+        // Prepare a new run from the given sources, reusing the memory of the previous one. Only the
+        // cells visited by the previous run are restored, so a short search costs little to reset.
+        // The targets are cleared, the other settings are kept.
+        void reset(const std::vector<size_t>& cellIds) {
+            if (isTouchedValid) {
+                for (auto id : touched) {
+                    status[id] = UNVISITED;
+                    previous[id] = EMPTY;
+                    smallestRes[id] = INF;
+                }
+            } else {
+                status.fill(UNVISITED);
+                previous.fill(EMPTY);
+                smallestRes.fill(INF);
+            }
+            touched.clear();
+            isTouchedValid = true;
+            clearTargets();
+            isResumed = false;
+            setSources(cellIds);
         }
 
         Grid* grid() {
             return gridPtr;
         };
 
-        CellField<double>* const run() {
-            while (!heap.empty()) {
-                const CellElement e = heap.top();
-                heap.pop();
+        const ActiveCells* activeCells() const {
+            return activePtr;
+        };
 
-                size_t cCell = e.cell;
-                const double cRes = -e.res;
+        // Stop as soon as all the given cells are settled (or the first one if all is false)
+        void setTargets(const std::vector<size_t>& cellIds, const bool all = true) {
+            clearTargets();
+            isTarget.resize(activePtr->size(), false);
+            for (auto cell : cellIds) {
+                const size_t id = activePtr->index(cell);
+                if (id != ActiveCells::NONE && !isTarget[id]) {
+                    isTarget[id] = true;
+                    targets.push_back(id);
+                }
+            }
+            nTargetsLeft = targets.size();
+            if (!all)
+                nTargetsLeft = std::min<size_t>(nTargetsLeft, 1);
+        }
 
-                status[cCell] = SCANNED;
-                smallestRes[cCell] = cRes;
+        // Stop as soon as the smallest key in the queue (resistance plus potential) exceeds
+        // maxResistance. Cells whose key exceeds maxResistance are never queued.
+        void setMaxResistance(const double maxResistance) {
+            maxRes = maxResistance;
+        }
 
-                // Loop on neighbors
-                auto neighbors = gridPtr->neighbors(cCell);
-                for (auto nCell : neighbors) {
-                    if (status[nCell] != SCANNED) {
-                        const double cnRes = computeResistance(cCell, nCell);
-                        const double nRes = cRes + cnRes;
-                        if (status[nCell] == UNVISITED) {
-                            previous[nCell] = cCell;
-                            status[nCell] = VISITED;
-                            cellElementHandles[nCell] = heap.push(CellElement(-nRes, nCell));
-                        } else /* status[nCell->id()] == VISITED */ {
-                            if (nRes <  -(*cellElementHandles[nCell]).res) {
-                                previous[nCell] = cCell;
-                                heap.increase(cellElementHandles[nCell], CellElement(-nRes, nCell));
-                            }
-                        }
-                    }
+        // Goal directed search (A*): the cells are queued by resistance plus potential(cell).
+        // The potential must be consistent, i.e. it cannot decrease between two neighbors
+        // more than the resistance between them, and zero at the targets.
+        void setPotential(const std::function<double(size_t)>& cellPotential) {
+            potential = cellPotential;
+        }
+
+        // Called with each settled cell before its neighbors are relaxed, e.g. to load the
+        // conductivity of the cell and of its neighbors on demand (with setConductivity)
+        void setFieldLoader(const std::function<void(size_t)>& loader) {
+            fieldLoader = loader;
+        }
+
+        void setConductivity(const size_t cell, const double value) {
+            const size_t id = activePtr->index(cell);
+            if (id != ActiveCells::NONE)
+                field[id] = value;
+        }
+
+        // Save the state to a journal every nPops settled cells and/or every seconds (0 to disable
+        // either criterion). Only the cells changed since the previous checkpoint are written, on a
+        // background thread. The key identifies the inputs (see ResultCache::key).
+        void setCheckpoint(const std::string& fileName, const size_t nPops, const double seconds,
+                           const uint64_t key = 0) {
+            checkpoint.reset(new Checkpoint(fileName, key, activePtr->size()));
+            checkpointPops = nPops;
+            checkpointSeconds = seconds;
+        }
+
+        // Load the state saved by the checkpoints of an interrupted run with the same inputs:
+        // run() rebuilds the queue from the visited cells and continues from there.
+        // Returns false if the file is missing or was written for a different key.
+        bool resume(const std::string& fileName, const uint64_t key = 0) {
+            Checkpoint journal(fileName, key, activePtr->size());
+            const bool isValid = journal.replay([this](const CheckpointRecord& record) {
+                status[record.id] = static_cast<Label>(record.status);
+                smallestRes[record.id] = record.res;
+                previous[record.id] = record.previous == ~0ULL ? EMPTY : static_cast<size_t>(record.previous);
+            });
+            isResumed = isResumed || isValid;
+            isTouchedValid = false;
+            return isValid;
+        }
+
+        // Accumulate the attributes of the least resistance paths (length, steps, smallest and largest
+        // conductivity) while relaxing, in the same pass as the resistances. Runs that do not relax
+        // every edge (resumed, cached, sweeping) get them from the predecessor tree when requested.
+        void setPathAttributes(const bool isEnabled) {
+            if (!isEnabled)
+                attributes.reset();
+            else if (!attributes)
+                attributes.reset(new PathAttributes(activePtr, INF, EMPTY));
+            isAccumulated = false;
+        }
+
+        // Call callback every nPops settled cells of each run (nothing else is done between the calls,
+        // the clock is read only then)
+        void setProgress(const std::function<void(const RunProgress&)>& callback, const size_t nPops = 65536) {
+            progress = callback;
+            samplePops = std::max<size_t>(nPops, 1);
+        }
+
+        // Stop the run as soon as *token is true, checked at the interval of setProgress (null to disable).
+        // A cancelled run ends as one stopped early, with its checkpoint written.
+        void setCancellation(const std::atomic<bool>* token) {
+            cancelToken = token;
+        }
+
+        // True if the last run was cancelled
+        bool cancelled() const {
+            return isCancelled;
+        }
+
+        // Use a bucket queue instead of the heap: the resistances are computed
+        // with a relative error smaller than eps (0 to use the exact algorithm)
+        void setApproximation(const double eps) {
+            epsilon = eps;
+        }
+
+        // Relative error bound achieved by the last run (0 if exact)
+        double errorBound() const {
+            return bound;
+        }
+
+        // Cells not settled before the termination keep the largest double value
+        ActiveCellField<double>* const run() {
+            if (epsilon > 0.) {
+                // Dial's algorithm is exact with buckets not wider than the smallest resistance between
+                // neighbors wMin. With buckets of width delta > wMin, each edge of the path adds an error
+                // smaller than delta-wMin, i.e. the relative error is smaller than delta/wMin-1
+                double kMin = std::numeric_limits<double>::max();
+                double kMax = 0.;
+                for (size_t i = 0; i < field.dof(); i++) {
+                    kMin = std::min(kMin, field[i]);
+                    kMax = std::max(kMax, field[i]);
+                }
+                // A zero conductivity makes the largest resistance infinite, the buckets cannot be sized
+                if (!(kMin > 0.) || !(kMax < std::numeric_limits<double>::infinity())) {
+                    throw std::runtime_error("ERROR: the bucket queue needs a positive and finite conductivity in "
+                                             "every active cell (mask the other cells)");
                 }
+                const double wMin = gridPtr->minNeighborDistance() / kMax;
+                const double wMax = gridPtr->maxNeighborDistance() / kMin;
+
+                const double maxBuckets = 1 << 24;
+                double delta = (1. + epsilon) * wMin;
+                if (2. * wMax / delta + 2 > maxBuckets) {
+                    delta = 2. * wMax / (maxBuckets - 2);
+                }
+                bound = std::max(delta / wMin - 1., 0.);
+
+                // With a potential the key can increase up to twice the resistance between neighbors
+                const double wSpan = potential ? 2. * wMax : wMax;
+                BucketQueue queue(activePtr->size(), delta, static_cast<size_t>(wSpan / delta) + 2);
+                runWith(queue);
+            } else {
+                bound = 0.;
+                if (!heapQueue)
+                    heapQueue.reset(new HeapQueue(activePtr->size()));
+                heapQueue->clear();
+                runWith(*heapQueue);
             }
 
             isReady = true;
             return &smallestRes;
         }
 
+        // Resistance map of the last run
+        ActiveCellField<double>* const resistance() {
+            return &smallestRes;
+        }
+
+        // Length of the least resistance path of each cell (largest double if not reached)
+        const ActiveCellField<double>& pathLength() {
+            return pathAttributes().length;
+        }
+
+        // Number of edges of the least resistance path of each cell (largest size_t if not reached)
+        const ActiveCellField<size_t>& pathSteps() {
+            return pathAttributes().steps;
+        }
+
+        // Smallest conductivity along the least resistance path of each cell, i.e. the bottleneck
+        const ActiveCellField<double>& pathMinConductivity() {
+            return pathAttributes().minK;
+        }
+
+        // Largest conductivity along the least resistance path of each cell
+        const ActiveCellField<double>& pathMaxConductivity() {
+            return pathAttributes().maxK;
+        }
+
+        // Cells of the least resistance path from cell back to its source
+        std::vector<size_t> pathCells(const size_t cell) const {
+            std::vector<size_t> cells;
+
+            if(!isReady)
+                return cells;
+
+            size_t cId = activePtr->index(cell);
+            while(cId != EMPTY) {
+                cells.push_back(activePtr->cell(cId));
+                cId = previous[cId];
+            }
+            return cells;
+        };
+
         CellField<size_t> path(const size_t cell) {
             CellField<size_t> pathField(grid(), 0);
 
             if(!isReady)
                 return pathField;
 
-            size_t cId = cell;
-            bool isTheStart = false;
-            while(!isTheStart) {
-                pathField.set(cId, 1);
-                size_t pCell = previous[cId];
-                if(pCell != EMPTY) {
-                    cId = pCell;
-                } else {
-                    isTheStart = true;
-                }
+            size_t cId = activePtr->index(cell);
+            while(cId != EMPTY) {
+                pathField.set(activePtr->cell(cId), 1);
+                cId = previous[cId];
             }
             return pathField;
         };
@@ -158,37 +415,447 @@ namespace mla {
             std::ofstream outStream;
             outStream.open(fileName);
             if (outStream.is_open()) {
-                size_t cId = cell;
-                bool isTheStart = false;
-                while(!isTheStart) {
-                    Point3D center = gridPtr->centerOfCell(cId);
-                    outStream << center.get(0) << ","
-                              << center.get(1) << ","
-                              << center.get(2) << std::endl;
-                    size_t pCell = previous[cId];
-                    if(pCell != EMPTY) {
-                        cId = pCell;
-                    } else {
-                        isTheStart = true;
-                    }
+                exportPath(cell, outStream);
+            }
+            outStream.close();
+
+
+        }
+
+        void exportPath(const size_t cell, std::ostream& outStream) const {
+            if(!isReady)
+                return;
+
+            const auto cells = pathCells(cell);
+            const Coordinates centers = gridPtr->centerOfCells(cells);
+            for (size_t i = 0; i < cells.size(); i++) {
+                outStream << centers.x[i] << ","
+                          << centers.y[i] << ","
+                          << centers.z[i] << '\n';
+            }
+        }
+
+        // Source cell of the least resistance path of each cell (largest size_t if not reached).
+        // The label is inherited from the predecessor, each chain of the tree is labeled once.
+        ActiveCellField<size_t> sourceLabels() const {
+            ActiveCellField<size_t> labels(activePtr, EMPTY, EMPTY);
+
+            if(!isReady)
+                return labels;
+
+            std::vector<size_t> chain;
+            for (size_t id = 0; id < labels.dof(); id++) {
+                if (labels[id] != EMPTY || smallestRes[id] == INF)
+                    continue;
+
+                size_t cId = id;
+                while (labels[cId] == EMPTY && previous[cId] != EMPTY) {
+                    chain.push_back(cId);
+                    cId = previous[cId];
+                }
+                const size_t label = labels[cId] != EMPTY ? labels[cId] : activePtr->cell(cId);
+                labels[cId] = label;
+                for (auto cellId : chain)
+                    labels[cellId] = label;
+                chain.clear();
+            }
+            return labels;
+        };
+
+        // Union of the least resistance paths of the given cells, as (cell, number of paths through
+        // the cell) pairs. The predecessor tree is walked once: each path stops at the first cell
+        // already on the tree, the counts are then accumulated from the leaves to the sources.
+        std::vector<std::pair<size_t, size_t>> pathTree(const std::vector<size_t>& cells) const {
+            std::vector<std::pair<size_t, size_t>> tree;
+
+            if(!isReady)
+                return tree;
+
+            std::unordered_map<size_t, size_t> position;
+            for (auto cell : cells) {
+                size_t cId = activePtr->index(cell);
+                if (cId == ActiveCells::NONE || smallestRes[cId] == INF)
+                    continue;
+
+                auto it = position.find(cId);
+                if (it != position.end()) {
+                    tree[it->second].second++;
+                    continue;
+                }
+                position[cId] = tree.size();
+                tree.emplace_back(cId, 1);
+
+                cId = previous[cId];
+                while (cId != EMPTY && position.find(cId) == position.end()) {
+                    position[cId] = tree.size();
+                    tree.emplace_back(cId, 0);
+                    cId = previous[cId];
                 }
             }
+
+            // A cell has a larger resistance than its predecessor
+            std::vector<size_t> order(tree.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+                return smallestRes[tree[a].first] > smallestRes[tree[b].first];
+            });
+            for (auto i : order) {
+                const size_t prevId = previous[tree[i].first];
+                if (prevId != EMPTY)
+                    tree[position[prevId]].second += tree[i].second;
+            }
+
+            for (auto& node : tree)
+                node.first = activePtr->cell(node.first);
+            return tree;
+        };
+
+        // Derivative of the sum of the resistances of the given cells with respect to the conductivity
+        // of each cell. The resistance of a cell is the sum of computeResistance along its path, so
+        // (away from ties) each edge adds -dist/2/k^2 to both its cells, times the number of paths
+        // through the edge. Cells outside the paths have a zero derivative.
+        ActiveCellField<double> sensitivity(const std::vector<size_t>& cells) const {
+            ActiveCellField<double> gradient(activePtr, 0., 0.);
+
+            if(!isReady)
+                return gradient;
+
+            for (auto& node : pathTree(cells)) {
+                const size_t cId = activePtr->index(node.first);
+                const size_t pId = previous[cId];
+                if (pId == EMPTY)
+                    continue;
+                const double dist = gridPtr->centerOfCell(node.first).distanceFrom(
+                        gridPtr->centerOfCell(activePtr->cell(pId)));
+                const double weight = static_cast<double>(node.second) * dist / 2.0;
+                gradient[cId] -= weight / (field[cId] * field[cId]);
+                gradient[pId] -= weight / (field[pId] * field[pId]);
+            }
+            return gradient;
+        };
+
+        // Write the union of the least resistance paths of the given cells as "x,y,z,cell,count" lines
+        void exportPathTree(const std::vector<size_t>& cells, const std::string& fileName) const {
+            if(!isReady)
+                return;
+
+            std::ofstream outStream;
+            outStream.open(fileName);
+            if (!outStream) {
+                throw std::runtime_error("ERROR: cannot open the file " + fileName);
+            }
+            exportPathTree(cells, outStream);
             outStream.close();
+        }
 
+        void exportPathTree(const std::vector<size_t>& cells, std::ostream& outStream) const {
+            if(!isReady)
+                return;
 
+            const auto tree = pathTree(cells);
+            std::vector<size_t> treeCells;
+            treeCells.reserve(tree.size());
+            for (auto& node : tree)
+                treeCells.push_back(node.first);
+            const Coordinates centers = gridPtr->centerOfCells(treeCells);
+            for (size_t i = 0; i < tree.size(); i++) {
+                outStream << centers.x[i] << ","
+                          << centers.y[i] << ","
+                          << centers.z[i] << ","
+                          << tree[i].first << ","
+                          << tree[i].second << '\n';
+            }
         }
 
     private:
 
-        double computeResistance(const size_t cCell, const size_t nCell) const {
+        void setSources(const std::vector<size_t>& cellIds) {
+            sources.clear();
+            for (size_t i = 0; i < cellIds.size(); i++) {
+                const size_t id = activePtr->index(cellIds[i]);
+                if (id == ActiveCells::NONE) {
+                    std::cerr << "WARNING: source cell " << cellIds[i] << " is inactive" << std::endl;
+                    continue;
+                }
+                sources.push_back(id);
+            }
+            isReady = false;
+            isAccumulated = false;
+        }
+
+        void clearTargets() {
+            for (auto id : targets)
+                isTarget[id] = false;
+            targets.clear();
+            nTargetsLeft = 0;
+        }
+
+        // smallestRes holds the tentative resistance of the visited cells while running
+        template<typename Queue>
+        void runWith(Queue& queue) {
+            const bool hasPotential = static_cast<bool>(potential);
+            const bool isCheckpointing = static_cast<bool>(checkpoint);
+
+            // The attributes of the cells settled before a checkpoint are not known yet
+            const bool isAccumulating = attributes && !isResumed;
+            if (isAccumulating) {
+                attributes->length.fill(INF);
+                attributes->steps.fill(EMPTY);
+                attributes->minK.fill(INF);
+                attributes->maxK.fill(INF);
+            }
+
+            if (isCheckpointing) {
+                isDirty.assign(activePtr->size(), 0);
+                dirty.clear();
+                checkpoint->create();
+            }
+
+            // The cells visited before the checkpoint go back to the queue
+            if (isResumed) {
+                for (size_t id = 0; id < status.dof(); id++) {
+                    if (status[id] == VISITED)
+                        queue.push(id, hasPotential ? smallestRes[id] + potential(activePtr->cell(id)) : smallestRes[id]);
+                    if (isCheckpointing && status[id] != UNVISITED)
+                        touch(id);
+                }
+            }
+
+            for (auto id : sources) {
+                if (status[id] == UNVISITED) {
+                    smallestRes[id] = 0.;
+                    queue.push(id, hasPotential ? potential(activePtr->cell(id)) : 0.);
+                    status[id] = VISITED;
+                    touched.push_back(id);
+                    if (isCheckpointing)
+                        touch(id);
+                }
+            }
+
+            const bool stopAtTargets = nTargetsLeft > 0;
+            if (isResumed && stopAtTargets) {
+                for (size_t id = 0; id < isTarget.size() && nTargetsLeft > 0; id++) {
+                    if (isTarget[id] && status[id] == SCANNED)
+                        nTargetsLeft--;
+                }
+            }
+
+            if (isCheckpointing)
+                saveCheckpoint();
+            size_t nPops = 0;
+            auto lastCheckpoint = std::chrono::steady_clock::now();
+
+            const bool isSampling = progress || cancelToken;
+            const auto start = std::chrono::steady_clock::now();
+            size_t nSettled = 0;
+            isCancelled = false;
+
+            while (!queue.empty() && !(stopAtTargets && nTargetsLeft == 0)) {
+                const size_t cId = queue.topCell();
+
+                if (queue.topRes() > maxRes)
+                    break;
+
+                queue.pop();
+                status[cId] = SCANNED;
+                if (isCheckpointing)
+                    touch(cId);
+                const double cRes = smallestRes[cId];
+
+                if (stopAtTargets && isTarget[cId] && --nTargetsLeft == 0)
+                    break;
+
+                // Loop on neighbors
+                const size_t cCell = activePtr->cell(cId);
+                if (fieldLoader)
+                    fieldLoader(cCell);
+                // A source starts its path once its conductivity is loaded
+                if (isAccumulating && previous[cId] == EMPTY)
+                    startPath(cId);
+                auto neighbors = gridPtr->neighbors(cCell);
+                for (auto nCell : neighbors) {
+                    const size_t nId = activePtr->index(nCell);
+                    if (nId == ActiveCells::NONE)
+                        continue;
+                    if (status[nId] != SCANNED) {
+                        const double cnRes = computeResistance(cId, cCell, nId, nCell);
+                        const double nRes = cRes + cnRes;
+                        if (status[nId] == UNVISITED) {
+                            const double nKey = hasPotential ? nRes + potential(nCell) : nRes;
+                            if (nKey > maxRes)
+                                continue;
+                            previous[nId] = cId;
+                            status[nId] = VISITED;
+                            smallestRes[nId] = nRes;
+                            touched.push_back(nId);
+                            if (isAccumulating)
+                                extendPath(cId, cCell, nId, nCell);
+                            queue.push(nId, nKey);
+                            if (isCheckpointing)
+                                touch(nId);
+                        } else /* status[nId] == VISITED */ {
+                            if (nRes < smallestRes[nId]) {
+                                previous[nId] = cId;
+                                smallestRes[nId] = nRes;
+                                if (isAccumulating)
+                                    extendPath(cId, cCell, nId, nCell);
+                                queue.decrease(nId, hasPotential ? nRes + potential(nCell) : nRes);
+                                if (isCheckpointing)
+                                    touch(nId);
+                            }
+                        }
+                    }
+                }
+
+                // The clock is read every 1024 settled cells
+                if (isCheckpointing) {
+                    nPops++;
+                    const bool isPopsDue = checkpointPops > 0 && nPops % checkpointPops == 0;
+                    const bool isTimeDue = checkpointSeconds > 0. && nPops % 1024 == 0 &&
+                            std::chrono::duration<double>(std::chrono::steady_clock::now() - lastCheckpoint).count()
+                            >= checkpointSeconds;
+                    if (isPopsDue || isTimeDue) {
+                        saveCheckpoint();
+                        lastCheckpoint = std::chrono::steady_clock::now();
+                    }
+                }
+
+                // After the relaxation, so a cancelled run can be resumed from its checkpoint. The token is
+                // read after the callback, which may set it, even if this was the last cell to settle.
+                if (isSampling && ++nSettled % samplePops == 0) {
+                    if (progress)
+                        reportProgress(nSettled, cRes, start);
+                    if (cancelToken && cancelToken->load(std::memory_order_relaxed)) {
+                        isCancelled = true;
+                        break;
+                    }
+                }
+            }
+
+            if (isCheckpointing) {
+                saveCheckpoint();
+                checkpoint->wait();
+            }
+            isResumed = false;
+
+            if (!queue.empty()) {
+                // Early termination: only the settled cells have a final resistance
+                const auto clearVisited = [&](const size_t id) {
+                    if (status[id] == VISITED) {
+                        smallestRes[id] = INF;
+                        if (isAccumulating)
+                            clearPath(id);
+                    }
+                };
+                if (isTouchedValid) {
+                    for (auto id : touched)
+                        clearVisited(id);
+                } else {
+                    for (size_t id = 0; id < status.dof(); id++)
+                        clearVisited(id);
+                }
+            }
+            isAccumulated = isAccumulating;
+        }
+
+        void startPath(const size_t id) {
+            attributes->length[id] = 0.;
+            attributes->steps[id] = 0;
+            attributes->minK[id] = field[id];
+            attributes->maxK[id] = field[id];
+        }
+
+        // The path of nId is the path of its predecessor cId plus the edge between them
+        void extendPath(const size_t cId, const size_t cCell, const size_t nId, const size_t nCell) {
+            const double dist = gridPtr->centerOfCell(cCell).distanceFrom(gridPtr->centerOfCell(nCell));
+            attributes->length[nId] = attributes->length[cId] + dist;
+            attributes->steps[nId] = attributes->steps[cId] + 1;
+            attributes->minK[nId] = std::min(attributes->minK[cId], field[nId]);
+            attributes->maxK[nId] = std::max(attributes->maxK[cId], field[nId]);
+        }
+
+        void clearPath(const size_t id) {
+            attributes->length[id] = INF;
+            attributes->steps[id] = EMPTY;
+            attributes->minK[id] = INF;
+            attributes->maxK[id] = INF;
+        }
+
+        // Attributes of the last run, rebuilt from the predecessor tree if they were not accumulated
+        // while relaxing. As in sourceLabels, each chain of the tree is walked once.
+        PathAttributes& pathAttributes() {
+            if (!attributes)
+                attributes.reset(new PathAttributes(activePtr, INF, EMPTY));
+            if (isAccumulated || !isReady)
+                return *attributes;
+
+            for (size_t id = 0; id < activePtr->size(); id++)
+                clearPath(id);
+            std::vector<size_t> chain;
+            for (size_t id = 0; id < activePtr->size(); id++) {
+                if (attributes->steps[id] != EMPTY || smallestRes[id] == INF)
+                    continue;
+
+                size_t cId = id;
+                while (attributes->steps[cId] == EMPTY && previous[cId] != EMPTY) {
+                    chain.push_back(cId);
+                    cId = previous[cId];
+                }
+                if (attributes->steps[cId] == EMPTY)
+                    startPath(cId);
+                for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+                    const size_t pId = previous[*it];
+                    extendPath(pId, activePtr->cell(pId), *it, activePtr->cell(*it));
+                }
+                chain.clear();
+            }
+            isAccumulated = true;
+            return *attributes;
+        }
+
+        void reportProgress(const size_t nSettled, const double res,
+                            const std::chrono::steady_clock::time_point& start) const {
+            RunProgress state;
+            state.settled = nSettled;
+            state.total = activePtr->size();
+            state.resistance = res;
+            state.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            const size_t nLeft = state.total > nSettled ? state.total - nSettled : 0;
+            state.eta = state.elapsed * static_cast<double>(nLeft) / static_cast<double>(nSettled);
+            progress(state);
+        }
+
+        void touch(const size_t id) {
+            if (!isDirty[id]) {
+                isDirty[id] = 1;
+                dirty.push_back(id);
+            }
+        }
+
+        // Hand the cells changed since the last checkpoint to the writer thread
+        void saveCheckpoint() {
+            std::vector<CheckpointRecord> records(dirty.size());
+            for (size_t i = 0; i < dirty.size(); i++) {
+                const size_t id = dirty[i];
+                records[i].id = id;
+                records[i].status = status[id];
+                records[i].res = smallestRes[id];
+                records[i].previous = previous[id] == EMPTY ? ~0ULL : previous[id];
+                isDirty[id] = 0;
+            }
+            dirty.clear();
+            checkpoint->write(std::move(records));
+        }
+
+        double computeResistance(const size_t cId, const size_t cCell, const size_t nId, const size_t nCell) const {
             // NOTE: it works only for Cartesian grids, it could be generalized for generic grids
             // using the distance between center of cells and a midpoint (either a corner or center of face)
             double dist = gridPtr->centerOfCell(cCell).distanceFrom(gridPtr->centerOfCell(nCell));
 
-            auto k1 = field.getFromCell(cCell);
+            auto k1 = field[cId];
             auto r1 = dist/2.0/k1;
 
-            auto k2 = field.getFromCell(nCell);
+            auto k2 = field[nId];
             auto r2 = dist/2.0/k2;
 
             return r1 + r2;
@@ -0,0 +1,217 @@
+/**
+* @file LocalConnectivity.h
+* @brief Local connectivity indicator: minimum hydraulic resistance from each cell
+*        to the boundary of its window of given radius
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_LOCALCONNECTIVITY_H
+#define LMA_LOCALCONNECTIVITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <CartesianGrid.h>
+#include <CellField.h>
+#include <ActiveCellField.h>
+
+namespace mla {
+
+    /**
+     * The indicator of a cell is the MHR from the cell to the cells of the shell of its window,
+     * i.e. the cells at radius cells from it along some axis (the window is clipped by the domain).
+     * Each cell runs its own Dijkstra search, stopped when the first cell of the shell is settled:
+     * the search never leaves the window, so its state is indexed by the position in the window
+     * and lives in a scratch of (2*radius+1)^3 values per thread, reused by all the searches of the
+     * thread. The rows of the grid are handed out to the threads one at a time, the windows of
+     * consecutive cells then overlap and stay in cache.
+     */
+    class LocalConnectivity {
+
+    public:
+
+        LocalConnectivity(CartesianGrid* grid, CellField<double>& field, const ActiveCells* active = nullptr) :
+                gridPtr(grid), allCells(grid), activePtr(active ? active : &allCells),
+                conductivity(activePtr), radius(1), nThreads(1) {
+            for (size_t i = 0; i < activePtr->size(); i++) {
+                conductivity[i] = field.getFromCell(activePtr->cell(i));
+            }
+        };
+
+        // Radius of the window in cells of the (refined) grid
+        void setRadius(const size_t r) {
+            radius = r > 0 ? r : 1;
+        }
+
+        void setThreads(const size_t n) {
+            nThreads = n > 0 ? n : 1;
+        }
+
+        // Indicator of each active cell (largest double if the shell cannot be reached)
+        ActiveCellField<double> run() {
+            ActiveCellField<double> indicator(activePtr, INF, INF);
+
+            stencil.clear();
+            for (const auto& s : gridPtr->offsets()) {
+                const double x = s[0] * gridPtr->dx();
+                const double y = s[1] * gridPtr->dy();
+                const double z = s[2] * gridPtr->dz();
+                stencil.push_back(std::make_pair(s, std::sqrt(x*x + y*y + z*z)));
+            }
+
+            const size_t nRows = gridPtr->ny() * gridPtr->nz();
+            std::atomic<size_t> nextRow(0);
+            auto work = [this, nRows, &nextRow, &indicator]() {
+                Scratch scratch(2 * radius + 1, gridPtr->nz() == 1 ? 1 : 2 * radius + 1);
+                for (size_t row = nextRow++; row < nRows; row = nextRow++) {
+                    const size_t j = row % gridPtr->ny();
+                    const size_t k = row / gridPtr->ny();
+                    for (size_t i = 0; i < gridPtr->nx(); i++) {
+                        const size_t id = activePtr->index(gridPtr->mergeIds(i, j, k));
+                        if (id != ActiveCells::NONE)
+                            indicator[id] = search(scratch, i, j, k);
+                    }
+                }
+            };
+
+            const size_t nWorkers = std::min(nThreads, nRows);
+            if (nWorkers <= 1) {
+                work();
+            } else {
+                std::vector<std::thread> workers;
+                for (size_t w = 0; w < nWorkers; w++)
+                    workers.emplace_back(work);
+                for (auto& worker : workers)
+                    worker.join();
+            }
+            return indicator;
+        }
+
+    private:
+
+        // State of the searches of one thread, indexed by the position in the window. A value is
+        // valid only if its stamp is the one of the current search, so nothing is cleared.
+        struct Scratch {
+            Scratch(const size_t width, const size_t depth) :
+                    width(width), res(width * width * depth), id(width * width * depth),
+                    visited(width * width * depth, 0), settled(width * width * depth, 0), stamp(0) {};
+
+            size_t width;
+            std::vector<double> res;
+            std::vector<size_t> id;
+            std::vector<uint32_t> visited;
+            std::vector<uint32_t> settled;
+            uint32_t stamp;
+            // Binary heap of (resistance, position in the window) with lazy deletion
+            std::vector<std::pair<double, size_t>> heap;
+        };
+
+        double search(Scratch& scratch, const size_t i, const size_t j, const size_t k) const {
+            if (++scratch.stamp == 0) {
+                std::fill(scratch.visited.begin(), scratch.visited.end(), 0);
+                std::fill(scratch.settled.begin(), scratch.settled.end(), 0);
+                scratch.stamp = 1;
+            }
+            const uint32_t stamp = scratch.stamp;
+            const std::greater<std::pair<double, size_t>> isAfter;
+            auto& heap = scratch.heap;
+            heap.clear();
+
+            // Window [i-r, i+r] x [j-r, j+r] x [k-r, k+r], the center is at (r, r, r)
+            const long r = static_cast<long>(radius);
+            const long w = static_cast<long>(scratch.width);
+            const long rz = gridPtr->nz() == 1 ? 0 : r;
+            const std::array<long, 3> n = {{static_cast<long>(gridPtr->nx()), static_cast<long>(gridPtr->ny()),
+                                            static_cast<long>(gridPtr->nz())}};
+            const std::array<long, 3> origin = {{static_cast<long>(i) - r, static_cast<long>(j) - r,
+                                                 static_cast<long>(k) - rz}};
+
+            const size_t center = static_cast<size_t>((rz * w + r) * w + r);
+            scratch.res[center] = 0.;
+            scratch.id[center] = activePtr->index(gridPtr->mergeIds(i, j, k));
+            scratch.visited[center] = stamp;
+            heap.push_back(std::make_pair(0., center));
+
+            while (!heap.empty()) {
+                std::pop_heap(heap.begin(), heap.end(), isAfter);
+                const double cRes = heap.back().first;
+                const size_t c = heap.back().second;
+                heap.pop_back();
+                if (scratch.settled[c] == stamp)
+                    continue;
+                scratch.settled[c] = stamp;
+
+                const long cx = static_cast<long>(c) % w;
+                const long cy = (static_cast<long>(c) / w) % w;
+                const long cz = static_cast<long>(c) / (w * w);
+                if (cx == 0 || cx == w - 1 || cy == 0 || cy == w - 1 || (rz > 0 && (cz == 0 || cz == w - 1)))
+                    return cRes;
+
+                const double k1 = conductivity[scratch.id[c]];
+                for (const auto& s : stencil) {
+                    const long x = origin[0] + cx + s.first[0];
+                    const long y = origin[1] + cy + s.first[1];
+                    const long z = origin[2] + cz + s.first[2];
+                    if (x < 0 || y < 0 || z < 0 || x >= n[0] || y >= n[1] || z >= n[2])
+                        continue;
+                    const size_t nb = static_cast<size_t>(((cz + s.first[2]) * w + cy + s.first[1]) * w + cx + s.first[0]);
+                    if (scratch.settled[nb] == stamp)
+                        continue;
+                    if (scratch.visited[nb] != stamp) {
+                        scratch.id[nb] = activePtr->index(gridPtr->mergeIds(static_cast<size_t>(x),
+                                static_cast<size_t>(y), static_cast<size_t>(z)));
+                        scratch.res[nb] = INF;
+                        scratch.visited[nb] = stamp;
+                    }
+                    if (scratch.id[nb] == ActiveCells::NONE)
+                        continue;
+                    const double nRes = cRes + s.second / 2. / k1 + s.second / 2. / conductivity[scratch.id[nb]];
+                    if (nRes < scratch.res[nb]) {
+                        scratch.res[nb] = nRes;
+                        heap.push_back(std::make_pair(nRes, nb));
+                        std::push_heap(heap.begin(), heap.end(), isAfter);
+                    }
+                }
+            }
+            return INF;
+        }
+
+        CartesianGrid* gridPtr;
+        ActiveCells allCells;
+        const ActiveCells* activePtr;
+        ActiveCellField<double> conductivity;
+        size_t radius;
+        size_t nThreads;
+
+        std::vector<std::pair<std::array<int, 3>, double>> stencil;
+
+        const double INF = std::numeric_limits<double>::max();
+
+    };
+}
+
+#endif //LMA_LOCALCONNECTIVITY_H
@@ -0,0 +1,289 @@
+/**
+* @file Multilevel.h
+* @brief Coarse-to-fine acceleration of LazyMole for distant sources and targets
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_MULTILEVEL_H
+#define LMA_MULTILEVEL_H
+
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <stdexcept>
+#include <CartesianGrid.h>
+#include <CellField.h>
+#include <ActiveCellField.h>
+#include "LazyMole.h"
+
+namespace mla {
+
+    enum Averaging {
+        ARITHMETIC = 0,
+        GEOMETRIC,
+        HARMONIC
+    };
+
+    /**
+     * The search runs on a coarse grid obtained by block averaging of the conductivity.
+     * The coarse least resistance path defines a corridor of fine cells where the fine
+     * search is restricted. The corridor search gives an upper bound of the MHR; if
+     * required, an exact goal directed search on the whole fine grid is pruned with it.
+     */
+    class Multilevel {
+
+    public:
+
+        Multilevel(CartesianGrid* grid, CellField<double>& field,
+                   const std::vector<size_t>& sourceIds, const std::vector<size_t>& targetIds,
+                   const ActiveCells* active = nullptr) :
+                gridPtr(grid), field(field), sources(sourceIds), targets(targetIds), activePtr(active),
+                factor(4), averaging(GEOMETRIC), width(1), verify(true),
+                upperBound(std::numeric_limits<double>::max()) {};
+
+        // Size of the coarse blocks (in fine cells per direction)
+        void setFactor(const size_t f) {
+            if (f == 0)
+                throw std::runtime_error("ERROR: the coarsening factor must be positive");
+            factor = f;
+        }
+
+        void setAveraging(const Averaging avg) {
+            averaging = avg;
+        }
+
+        // Half width of the corridor around the coarse path (in coarse cells)
+        void setCorridorWidth(const size_t w) {
+            width = w;
+        }
+
+        // Run the exact search pruned with the corridor resistance
+        void setVerify(const bool v) {
+            verify = v;
+        }
+
+        // Number of fine cells in the corridor
+        size_t corridorSize() const {
+            return corridor ? corridor->size() : 0;
+        }
+
+        // MHR found in the corridor (upper bound of the exact MHR)
+        double corridorResistance() const {
+            return upperBound;
+        }
+
+        // Returns the fine solver holding the final resistances and path
+        LazyMole& run() {
+            // Coarse solve
+            const size_t fx = factor;
+            const size_t fy = factor;
+            const size_t fz = gridPtr->nz() == 1 ? 1 : factor;
+            const size_t ncx = (gridPtr->nx() + fx - 1) / fx;
+            const size_t ncy = (gridPtr->ny() + fy - 1) / fy;
+            const size_t ncz = (gridPtr->nz() + fz - 1) / fz;
+            coarseGrid.reset(new CartesianGrid(ncx, ncy, ncz,
+                                               gridPtr->dx()*fx, gridPtr->dy()*fy, gridPtr->dz()*fz));
+            coarseGrid->setStencil(gridPtr->stencil());
+            CellField<double> coarseField(coarseGrid.get(), 0.);
+            upscale(coarseField, fx, fy, fz);
+
+            LazyMole coarseMole(coarseGrid.get(), coarseField, toCoarse(sources, fx, fy, fz), coarseActive.get());
+            coarseMole.setTargets(toCoarse(targets, fx, fy, fz), false);
+            auto coarseRes = coarseMole.run();
+            size_t coarseTarget = bestTarget(*coarseRes, toCoarse(targets, fx, fy, fz));
+            if (coarseTarget == coarseGrid->numberOfCells())
+                throw std::runtime_error("ERROR: no target cell can be reached on the coarse grid");
+
+            // Corridor around the coarse path
+            std::vector<char> coarseMask(coarseGrid->numberOfCells(), 0);
+            for (auto cell : coarseMole.pathCells(coarseTarget)) {
+                auto ids = coarseGrid->splitId(cell);
+                for (size_t k = sub(ids[2], width); k <= std::min(ids[2] + width, ncz - 1); k++)
+                    for (size_t j = sub(ids[1], width); j <= std::min(ids[1] + width, ncy - 1); j++)
+                        for (size_t i = sub(ids[0], width); i <= std::min(ids[0] + width, ncx - 1); i++)
+                            coarseMask[coarseGrid->mergeIds(i, j, k)] = 1;
+            }
+            std::vector<char> mask(gridPtr->numberOfCells(), 0);
+            for (size_t cell = 0; cell < mask.size(); cell++) {
+                if (activePtr && !activePtr->isActive(cell))
+                    continue;
+                auto ids = gridPtr->splitId(cell);
+                mask[cell] = coarseMask[coarseGrid->mergeIds(ids[0]/fx, ids[1]/fy, ids[2]/fz)];
+            }
+            corridor.reset(new ActiveCells(gridPtr, mask));
+
+            // Fine solve in the corridor
+            corridorMole.reset(new LazyMole(gridPtr, field, inside(sources, *corridor), corridor.get()));
+            corridorMole->setTargets(targets, false);
+            auto corridorRes = corridorMole->run();
+            const size_t corridorTarget = bestTarget(*corridorRes, targets);
+            upperBound = corridorTarget != gridPtr->numberOfCells() ?
+                         corridorRes->getFromCell(corridorTarget) : std::numeric_limits<double>::max();
+
+            if (!verify)
+                return *corridorMole;
+
+            // Exact goal directed search on the fine grid: any path with a resistance
+            // larger than the corridor one can be discarded
+            exactMole.reset(new LazyMole(gridPtr, field, activePtr ? inside(sources, *activePtr) : sources,
+                                         activePtr));
+            exactMole->setTargets(targets, false);
+            exactMole->setPotential(distancePotential());
+            if (upperBound < std::numeric_limits<double>::max())
+                exactMole->setMaxResistance(upperBound * (1. + 1e-12));
+            exactMole->run();
+            return *exactMole;
+        }
+
+    private:
+
+        CartesianGrid* gridPtr;
+        CellField<double>& field;
+        std::vector<size_t> sources;
+        std::vector<size_t> targets;
+        const ActiveCells* activePtr;
+
+        size_t factor;
+        Averaging averaging;
+        size_t width;
+        bool verify;
+
+        double upperBound;
+
+        std::unique_ptr<CartesianGrid> coarseGrid;
+        std::unique_ptr<ActiveCells> coarseActive;
+        std::unique_ptr<ActiveCells> corridor;
+        std::unique_ptr<LazyMole> corridorMole;
+        std::unique_ptr<LazyMole> exactMole;
+
+        static size_t sub(const size_t a, const size_t b) {
+            return a > b ? a - b : 0;
+        }
+
+        void upscale(CellField<double>& coarseField, const size_t fx, const size_t fy, const size_t fz) {
+            std::vector<double> sum(coarseField.dof(), 0.);
+            std::vector<size_t> count(coarseField.dof(), 0);
+            for (size_t cell = 0; cell < gridPtr->numberOfCells(); cell++) {
+                if (activePtr && !activePtr->isActive(cell))
+                    continue;
+                auto ids = gridPtr->splitId(cell);
+                const size_t cCell = coarseGrid->mergeIds(ids[0]/fx, ids[1]/fy, ids[2]/fz);
+                const double k = field.getFromCell(cell);
+                switch (averaging) {
+                    case ARITHMETIC: sum[cCell] += k; break;
+                    case GEOMETRIC: sum[cCell] += std::log(k); break;
+                    case HARMONIC: sum[cCell] += 1./k; break;
+                }
+                count[cCell]++;
+            }
+            std::vector<char> coarseMask(coarseField.dof(), 1);
+            for (size_t cCell = 0; cCell < coarseField.dof(); cCell++) {
+                if (count[cCell] == 0) {
+                    // Block without active cells
+                    coarseMask[cCell] = 0;
+                    continue;
+                }
+                const double mean = sum[cCell] / count[cCell];
+                switch (averaging) {
+                    case ARITHMETIC: coarseField.set(cCell, mean); break;
+                    case GEOMETRIC: coarseField.set(cCell, std::exp(mean)); break;
+                    case HARMONIC: coarseField.set(cCell, 1./mean); break;
+                }
+            }
+            coarseActive.reset(new ActiveCells(coarseGrid.get(), coarseMask));
+        }
+
+        std::vector<size_t> toCoarse(const std::vector<size_t>& cells,
+                                     const size_t fx, const size_t fy, const size_t fz) const {
+            std::vector<size_t> coarseCells;
+            for (auto cell : cells) {
+                if (activePtr && !activePtr->isActive(cell))
+                    continue;
+                auto ids = gridPtr->splitId(cell);
+                coarseCells.push_back(coarseGrid->mergeIds(ids[0]/fx, ids[1]/fy, ids[2]/fz));
+            }
+            std::sort(coarseCells.begin(), coarseCells.end());
+            coarseCells.erase(std::unique(coarseCells.begin(), coarseCells.end()), coarseCells.end());
+            return coarseCells;
+        }
+
+        static std::vector<size_t> inside(const std::vector<size_t>& cells, const ActiveCells& active) {
+            std::vector<size_t> insideCells;
+            for (auto cell : cells) {
+                if (active.isActive(cell))
+                    insideCells.push_back(cell);
+            }
+            return insideCells;
+        }
+
+        static size_t bestTarget(const ActiveCellField<double>& res, const std::vector<size_t>& cells) {
+            double minRes = std::numeric_limits<double>::max();
+            size_t minId = res.grid()->numberOfCells();
+            for (auto cell : cells) {
+                if (res.getFromCell(cell) < minRes) {
+                    minRes = res.getFromCell(cell);
+                    minId = cell;
+                }
+            }
+            return minId;
+        }
+
+        // Distance from the bounding box of the targets divided by the largest conductivity:
+        // each neighbor contributes at least dist/kMax, so the potential is consistent
+        std::function<double(size_t)> distancePotential() const {
+            Point3D lo(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                       std::numeric_limits<double>::max());
+            Point3D hi(-std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(),
+                       -std::numeric_limits<double>::max());
+            for (auto cell : targets) {
+                const Point3D c = gridPtr->centerOfCell(cell);
+                for (size_t d = 0; d < 3; d++) {
+                    lo.set(d, std::min(lo.get(d), c.get(d)));
+                    hi.set(d, std::max(hi.get(d), c.get(d)));
+                }
+            }
+
+            double kMax = 0.;
+            for (size_t cell = 0; cell < gridPtr->numberOfCells(); cell++) {
+                if (!activePtr || activePtr->isActive(cell))
+                    kMax = std::max(kMax, field.getFromCell(cell));
+            }
+
+            CartesianGrid* grid = gridPtr;
+            return [grid, lo, hi, kMax](size_t cell) {
+                const Point3D c = grid->centerOfCell(cell);
+                double dist2 = 0.;
+                for (size_t d = 0; d < 3; d++) {
+                    const double delta = std::max(std::max(lo.get(d) - c.get(d), c.get(d) - hi.get(d)), 0.);
+                    dist2 += delta * delta;
+                }
+                return std::sqrt(dist2) / kMax;
+            };
+        }
+
+    };
+
+}
+
+
+#endif //LMA_MULTILEVEL_H
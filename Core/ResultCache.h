@@ -0,0 +1,219 @@
+/**
+* @file ResultCache.h
+* @brief On-disk cache of the resistance map and of the predecessor tree
+*        keyed by a hash of the inputs of LazyMole
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_RESULTCACHE_H
+#define LMA_RESULTCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <CartesianGrid.h>
+#include "LazyMole.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace mla {
+
+    /**
+     * File layout (native endianness, 64 bit words so that the file can be mapped in memory):
+     *   header    magic, version, key, number of active cells, error bound, 3 reserved words
+     *   double    resistance of each active cell (largest double if not settled)
+     *   uint64    compact index of the predecessor of each active cell (largest uint64 for the sources)
+     */
+    class ResultCache {
+
+    public:
+
+        ResultCache(const std::string& fileName) : fileName(fileName) {};
+
+        // FNV-1a hash of the grid, active cells, field, sources and solver options of lazyMole.
+        // Must be called before running lazyMole (the targets are part of the key only when
+        // they are used to stop the search). Runs with a potential (A*) cannot be cached.
+        static uint64_t key(const LazyMole& lazyMole) {
+            if (lazyMole.potential) {
+                throw std::runtime_error("ERROR: runs with a potential cannot be cached");
+            }
+            const CartesianGrid* grid = dynamic_cast<const CartesianGrid*>(lazyMole.gridPtr);
+            if (grid == nullptr) {
+                throw std::runtime_error("ERROR: only results on Cartesian grids can be cached");
+            }
+
+            uint64_t hash = OFFSET;
+            add(hash, VERSION);
+            add(hash, static_cast<uint64_t>(grid->nx()));
+            add(hash, static_cast<uint64_t>(grid->ny()));
+            add(hash, static_cast<uint64_t>(grid->nz()));
+            add(hash, grid->dx());
+            add(hash, grid->dy());
+            add(hash, grid->dz());
+            add(hash, static_cast<uint64_t>(grid->stencil()));
+
+            const ActiveCells* active = lazyMole.activePtr;
+            add(hash, static_cast<uint64_t>(active->size()));
+            if (!active->isAll()) {
+                for (size_t id = 0; id < active->size(); id++)
+                    add(hash, static_cast<uint64_t>(active->cell(id)));
+            }
+            for (size_t id = 0; id < lazyMole.field.dof(); id++)
+                add(hash, lazyMole.field[id]);
+
+            add(hash, static_cast<uint64_t>(lazyMole.sources.size()));
+            for (auto id : lazyMole.sources)
+                add(hash, static_cast<uint64_t>(id));
+
+            add(hash, lazyMole.epsilon);
+            add(hash, lazyMole.maxRes);
+            add(hash, static_cast<uint64_t>(lazyMole.nTargetsLeft));
+            if (lazyMole.nTargetsLeft > 0) {
+                for (size_t id = 0; id < lazyMole.isTarget.size(); id++) {
+                    if (lazyMole.isTarget[id])
+                        add(hash, static_cast<uint64_t>(id));
+                }
+            }
+            return hash;
+        };
+
+        // Restore the result of a previous run into lazyMole, false if the file is missing
+        // or was written for different inputs
+        bool load(const uint64_t key, LazyMole& lazyMole) const {
+            const size_t nActive = lazyMole.activePtr->size();
+            const size_t size = HEADER_SIZE + nActive * (sizeof(double) + sizeof(uint64_t));
+
+#ifndef _WIN32
+            const int fd = open(fileName.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat info;
+            if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) != size) {
+                close(fd);
+                return false;
+            }
+            void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (data == MAP_FAILED)
+                return false;
+            const bool isValid = restore(static_cast<const char*>(data), key, lazyMole);
+            munmap(data, size);
+            return isValid;
+#else
+            std::ifstream inStream(fileName, std::ios::binary);
+            if (!inStream)
+                return false;
+            std::vector<char> data(size);
+            if (!inStream.read(data.data(), size) || inStream.peek() != EOF)
+                return false;
+            return restore(data.data(), key, lazyMole);
+#endif
+        };
+
+        // Write the result of the last run of lazyMole
+        void save(const uint64_t key, const LazyMole& lazyMole) const {
+            std::ofstream outStream(fileName, std::ios::binary);
+            if (!outStream) {
+                throw std::runtime_error("ERROR: cannot open the file " + fileName);
+            }
+
+            const size_t nActive = lazyMole.activePtr->size();
+            uint64_t header[HEADER_WORDS] = {MAGIC, VERSION, key, static_cast<uint64_t>(nActive), 0, 0, 0, 0};
+            std::memcpy(&header[4], &lazyMole.bound, sizeof(double));
+            outStream.write(reinterpret_cast<const char*>(header), HEADER_SIZE);
+
+            for (size_t id = 0; id < nActive; id++) {
+                const double res = lazyMole.smallestRes[id];
+                outStream.write(reinterpret_cast<const char*>(&res), sizeof(double));
+            }
+            for (size_t id = 0; id < nActive; id++) {
+                const uint64_t prev = lazyMole.previous[id] == lazyMole.EMPTY ? EMPTY : lazyMole.previous[id];
+                outStream.write(reinterpret_cast<const char*>(&prev), sizeof(uint64_t));
+            }
+
+            if (!outStream) {
+                throw std::runtime_error("ERROR: cannot write the file " + fileName);
+            }
+            outStream.close();
+        };
+
+    private:
+
+        static bool restore(const char* data, const uint64_t key, LazyMole& lazyMole) {
+            const size_t nActive = lazyMole.activePtr->size();
+            uint64_t header[HEADER_WORDS];
+            std::memcpy(header, data, HEADER_SIZE);
+            if (header[0] != MAGIC || header[1] != VERSION || header[2] != key || header[3] != nActive)
+                return false;
+
+            std::memcpy(&lazyMole.bound, &header[4], sizeof(double));
+            const char* resData = data + HEADER_SIZE;
+            const char* prevData = resData + nActive * sizeof(double);
+            for (size_t id = 0; id < nActive; id++) {
+                double res;
+                uint64_t prev;
+                std::memcpy(&res, resData + id * sizeof(double), sizeof(double));
+                std::memcpy(&prev, prevData + id * sizeof(uint64_t), sizeof(uint64_t));
+                lazyMole.smallestRes[id] = res;
+                lazyMole.previous[id] = prev == EMPTY ? lazyMole.EMPTY : static_cast<size_t>(prev);
+                lazyMole.status[id] = res != lazyMole.INF ? LazyMole::SCANNED : LazyMole::UNVISITED;
+            }
+            lazyMole.isReady = true;
+            lazyMole.isAccumulated = false;
+            lazyMole.isTouchedValid = false;
+            return true;
+        };
+
+        static void add(uint64_t& hash, const uint64_t value) {
+            for (size_t i = 0; i < sizeof(uint64_t); i++) {
+                hash ^= (value >> (8 * i)) & 0xff;
+                hash *= PRIME;
+            }
+        };
+
+        static void add(uint64_t& hash, const double value) {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(double));
+            add(hash, bits);
+        };
+
+        static const uint64_t OFFSET = 14695981039346656037ULL;
+        static const uint64_t PRIME = 1099511628211ULL;
+        static const uint64_t MAGIC = 0x3145484341434d4cULL; // "LMCACHE1"
+        static const uint64_t VERSION = 1;
+        static const uint64_t EMPTY = ~0ULL;
+        static const size_t HEADER_WORDS = 8;
+        static const size_t HEADER_SIZE = HEADER_WORDS * sizeof(uint64_t);
+
+        std::string fileName;
+
+    };
+}
+
+
+#endif //LMA_RESULTCACHE_H
@@ -0,0 +1,458 @@
+/**
+* @file SlabSolver.cpp
+* @brief Domain decomposed minimum hydraulic resistance on several MPI processes
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SlabSolver.h"
+#include <cmath>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace lma {
+
+    static const int TAG_LAYER = 1;
+    static const int TAG_PATH = 2;
+    static const int TAG_GHOST = 3;
+
+    SlabSolver::SlabSolver(const mla::CartesianGrid* grid, MPI_Comm comm) : gridPtr(grid), comm(comm)
+    {
+        MPI_Comm_rank(comm, &commRank);
+        MPI_Comm_size(comm, &commSize);
+
+        const bool is3d = grid->nz() > 1;
+        nLayers = is3d ? grid->nz() : grid->ny();
+        layerSize = is3d ? grid->nx() * grid->ny() : grid->nx();
+        layerRes = is3d ? grid->resz() : grid->resy();
+        if (nLayers < static_cast<size_t>(commSize))
+        {
+            throw std::runtime_error("ERROR: " + std::to_string(commSize) + " processes for " +
+                                     std::to_string(nLayers) + " layers of cells, use at most one process per layer");
+        }
+        if (layerSize > static_cast<size_t>(std::numeric_limits<int>::max()))
+        {
+            throw std::runtime_error("ERROR: the layers of the grid are too large for the MPI messages");
+        }
+
+        first = static_cast<size_t>(commRank) * nLayers / static_cast<size_t>(commSize);
+        last = static_cast<size_t>(commRank + 1) * nLayers / static_cast<size_t>(commSize);
+        firstStored = first > 0 ? first - 1 : 0;
+        nStored = std::min(last + 1, nLayers) - firstStored;
+
+        const long nx = static_cast<long>(grid->nx());
+        const long ny = static_cast<long>(grid->ny());
+        for (const auto& s : grid->offsets())
+        {
+            const double x = s[0] * grid->dx();
+            const double y = s[1] * grid->dy();
+            const double z = s[2] * grid->dz();
+            Neighbor neighbor = {(s[2] * ny + s[1]) * nx + s[0], s, std::sqrt(x*x + y*y + z*z)};
+            stencil.push_back(neighbor);
+        }
+
+        conductivity.assign(nStored * layerSize, 0.);
+    }
+
+    bool SlabSolver::owns(const size_t cell) const
+    {
+        const size_t layer = layerOf(cell);
+        return layer >= first && layer < last;
+    }
+
+    void SlabSolver::loadField(std::istream& inStream, const size_t nSkip, const bool isLog)
+    {
+        std::string line;
+        for (size_t i = 0; i < nSkip; i++)
+        {
+            std::getline(inStream, line);
+        }
+
+        // Coarse layers (before the refinement) that cover the stored layers
+        const size_t cnx = gridPtr->nx() / gridPtr->resx();
+        const size_t cny = gridPtr->ny() / gridPtr->resy();
+        const size_t cnz = gridPtr->nz() / gridPtr->resz();
+        const size_t firstCoarse = firstStored / layerRes;
+        const size_t lastCoarse = (firstStored + nStored - 1) / layerRes;
+        const bool is3d = gridPtr->nz() > 1;
+
+        for (size_t k = 0; k < cnz; k++)
+            for (size_t j = 0; j < cny; j++)
+            {
+                const size_t layer = is3d ? k : j;
+                if (layer > lastCoarse)
+                    return;
+                for (size_t i = 0; i < cnx; i++)
+                {
+                    double val;
+                    inStream >> val;
+                    if (inStream.eof())
+                    {
+                        std::cerr << "WARNING: not enough values in iStream for the conductivity" << std::endl;
+                        return;
+                    }
+                    if (layer >= firstCoarse)
+                        setValue(i, j, k, isLog ? std::exp(val) : val);
+                }
+            }
+    }
+
+    void SlabSolver::loadField(const TileFile& file, const bool isLog)
+    {
+        if (file.nx() * gridPtr->resx() != gridPtr->nx() || file.ny() * gridPtr->resy() != gridPtr->ny() ||
+            file.nz() * gridPtr->resz() != gridPtr->nz())
+        {
+            throw std::runtime_error("ERROR: the tile file does not match the size of the grid");
+        }
+
+        const size_t axis = gridPtr->nz() > 1 ? 2 : 1;
+        const size_t firstCoarse = firstStored / layerRes;
+        const size_t lastCoarse = (firstStored + nStored - 1) / layerRes;
+        std::vector<double> values;
+        for (size_t tile = 0; tile < file.numberOfTiles(); tile++)
+        {
+            const auto box = file.tileBox(tile);
+            if (box[axis + 3] <= firstCoarse || box[axis] > lastCoarse)
+                continue;
+            file.readTile(tile, values);
+            size_t n = 0;
+            for (size_t k = box[2]; k < box[5]; k++)
+                for (size_t j = box[1]; j < box[4]; j++)
+                    for (size_t i = box[0]; i < box[3]; i++)
+                    {
+                        const double val = values[n++];
+                        setValue(i, j, k, isLog ? std::exp(val) : val);
+                    }
+        }
+    }
+
+    void SlabSolver::setSources(const std::vector<size_t>& cells)
+    {
+        sources.clear();
+        for (auto cell : cells)
+        {
+            if (owns(cell))
+                sources.push_back(local(cell));
+        }
+    }
+
+    size_t SlabSolver::run()
+    {
+        res.assign(nStored * layerSize, INF);
+        previous.assign(nStored * layerSize, EMPTY);
+        sentFirst.assign(layerSize, INF);
+        sentLast.assign(layerSize, INF);
+
+        std::vector<std::pair<double, size_t>> heap;
+        for (auto id : sources)
+        {
+            res[id] = 0.;
+            heap.push_back(std::make_pair(0., id));
+        }
+        std::make_heap(heap.begin(), heap.end(), std::greater<std::pair<double, size_t>>());
+
+        size_t nRounds = 0;
+        int isChanged = 1;
+        while (isChanged)
+        {
+            relax(heap);
+            nRounds++;
+            int isLocalChanged = exchange(heap) ? 1 : 0;
+            MPI_Allreduce(&isLocalChanged, &isChanged, 1, MPI_INT, MPI_LOR, comm);
+        }
+        return nRounds;
+    }
+
+    double SlabSolver::resistance(const size_t cell) const
+    {
+        return res[local(cell)];
+    }
+
+    std::pair<double, size_t> SlabSolver::best(const std::vector<size_t>& targets) const
+    {
+        // Smallest resistance, then the first target of the list with that resistance
+        double localMin = INF;
+        for (auto cell : targets)
+        {
+            if (owns(cell))
+                localMin = std::min(localMin, resistance(cell));
+        }
+        double minRes;
+        MPI_Allreduce(&localMin, &minRes, 1, MPI_DOUBLE, MPI_MIN, comm);
+
+        uint64_t localPosition = targets.size();
+        for (size_t p = 0; p < targets.size() && minRes < INF; p++)
+        {
+            if (owns(targets[p]) && resistance(targets[p]) == minRes)
+            {
+                localPosition = p;
+                break;
+            }
+        }
+        uint64_t position;
+        MPI_Allreduce(&localPosition, &position, 1, MPI_UINT64_T, MPI_MIN, comm);
+
+        if (position == targets.size())
+            return std::make_pair(INF, gridPtr->numberOfCells());
+        return std::make_pair(minRes, targets[position]);
+    }
+
+    void SlabSolver::exportResistance(std::ostream* outStream, const bool sparse) const
+    {
+        std::vector<double> layer(layerSize);
+        if (commRank != 0)
+        {
+            for (size_t l = first; l < last; l++)
+            {
+                MPI_Send(&res[(l - firstStored) * layerSize], static_cast<int>(layerSize), MPI_DOUBLE, 0, TAG_LAYER, comm);
+            }
+            return;
+        }
+
+        for (int r = 0; r < commSize; r++)
+        {
+            const size_t rFirst = static_cast<size_t>(r) * nLayers / static_cast<size_t>(commSize);
+            const size_t rLast = static_cast<size_t>(r + 1) * nLayers / static_cast<size_t>(commSize);
+            for (size_t l = rFirst; l < rLast; l++)
+            {
+                if (r == 0)
+                    std::copy(res.begin() + (l - firstStored) * layerSize, res.begin() + (l - firstStored + 1) * layerSize,
+                              layer.begin());
+                else
+                    MPI_Recv(layer.data(), static_cast<int>(layerSize), MPI_DOUBLE, r, TAG_LAYER, comm, MPI_STATUS_IGNORE);
+                for (size_t c = 0; c < layerSize; c++)
+                {
+                    if (!sparse)
+                        *outStream << layer[c] << '\n';
+                    else if (layer[c] != INF)
+                        *outStream << l * layerSize + c << " " << layer[c] << '\n';
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> SlabSolver::pathCells(const size_t cell) const
+    {
+        // The owner of the current cell follows the predecessors until the path leaves its slab
+        std::vector<size_t> cells;
+        uint64_t current = cell;
+        while (current != EMPTY)
+        {
+            const int cellOwner = owner(static_cast<size_t>(current));
+            std::vector<uint64_t> part;
+            if (commRank == cellOwner)
+            {
+                while (current != EMPTY && owns(static_cast<size_t>(current)))
+                {
+                    part.push_back(current);
+                    current = previous[local(static_cast<size_t>(current))];
+                }
+            }
+            MPI_Bcast(&current, 1, MPI_UINT64_T, cellOwner, comm);
+
+            if (cellOwner != 0 && commRank == cellOwner)
+            {
+                uint64_t count = part.size();
+                MPI_Send(&count, 1, MPI_UINT64_T, 0, TAG_PATH, comm);
+                MPI_Send(part.data(), static_cast<int>(count), MPI_UINT64_T, 0, TAG_PATH, comm);
+            }
+            else if (cellOwner != 0 && commRank == 0)
+            {
+                uint64_t count;
+                MPI_Recv(&count, 1, MPI_UINT64_T, cellOwner, TAG_PATH, comm, MPI_STATUS_IGNORE);
+                part.resize(count);
+                MPI_Recv(part.data(), static_cast<int>(count), MPI_UINT64_T, cellOwner, TAG_PATH, comm, MPI_STATUS_IGNORE);
+            }
+            if (commRank == 0)
+                cells.insert(cells.end(), part.begin(), part.end());
+        }
+        return cells;
+    }
+
+    void SlabSolver::exportPath(const size_t cell, std::ostream* outStream) const
+    {
+        const auto cells = pathCells(cell);
+        if (commRank != 0)
+            return;
+        const mla::Coordinates centers = gridPtr->centerOfCells(cells);
+        for (size_t i = 0; i < cells.size(); i++)
+        {
+            *outStream << centers.x[i] << ","
+                       << centers.y[i] << ","
+                       << centers.z[i] << '\n';
+        }
+    }
+
+    void SlabSolver::relax(std::vector<std::pair<double, size_t>>& heap)
+    {
+        const std::greater<std::pair<double, size_t>> isAfter;
+        const long n[3] = {static_cast<long>(gridPtr->nx()), static_cast<long>(gridPtr->ny()),
+                           static_cast<long>(gridPtr->nz())};
+        const size_t axis = gridPtr->nz() > 1 ? 2 : 1;
+        while (!heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end(), isAfter);
+            const double cRes = heap.back().first;
+            const size_t cId = heap.back().second;
+            heap.pop_back();
+            if (cRes > res[cId])
+                continue;
+
+            // Only the cells of the slab are relaxed, the ghost cells belong to the neighbors
+            const size_t cCell = global(cId);
+            const auto ids = gridPtr->splitId(cCell);
+            for (const auto& s : stencil)
+            {
+                long p[3];
+                for (size_t a = 0; a < 3; a++)
+                    p[a] = static_cast<long>(ids[a]) + s.offset[a];
+                if (p[0] < 0 || p[1] < 0 || p[2] < 0 || p[0] >= n[0] || p[1] >= n[1] || p[2] >= n[2])
+                    continue;
+                if (p[axis] < static_cast<long>(first) || p[axis] >= static_cast<long>(last))
+                    continue;
+
+                const size_t nId = static_cast<size_t>(static_cast<long>(cId) + s.shift);
+                const double nRes = cRes + s.dist / 2.0 / conductivity[cId] + s.dist / 2.0 / conductivity[nId];
+                if (nRes < res[nId])
+                {
+                    res[nId] = nRes;
+                    previous[nId] = cCell;
+                    heap.push_back(std::make_pair(nRes, nId));
+                    std::push_heap(heap.begin(), heap.end(), isAfter);
+                }
+            }
+        }
+    }
+
+    bool SlabSolver::exchange(std::vector<std::pair<double, size_t>>& heap)
+    {
+        const int lower = commRank > 0 ? commRank - 1 : MPI_PROC_NULL;
+        const int upper = commRank < commSize - 1 ? commRank + 1 : MPI_PROC_NULL;
+
+        // Down: the first layer goes to the lower neighbor, the upper ghost layer comes from the upper one.
+        // Up: the last layer goes to the upper neighbor, the lower ghost layer comes from the lower one.
+        std::vector<std::pair<size_t, double>> fromUpper;
+        std::vector<std::pair<size_t, double>> fromLower;
+        sendReceive(first, sentFirst, lower, upper, fromUpper);
+        sendReceive(last - 1, sentLast, upper, lower, fromLower);
+
+        bool isChanged = false;
+        const std::greater<std::pair<double, size_t>> isAfter;
+        for (int side = 0; side < 2; side++)
+        {
+            const auto& received = side == 0 ? fromUpper : fromLower;
+            const size_t ghost = side == 0 ? last : first - 1;
+            for (const auto& update : received)
+            {
+                const size_t id = (ghost - firstStored) * layerSize + update.first;
+                if (update.second < res[id])
+                {
+                    res[id] = update.second;
+                    heap.push_back(std::make_pair(update.second, id));
+                    std::push_heap(heap.begin(), heap.end(), isAfter);
+                    isChanged = true;
+                }
+            }
+        }
+        return isChanged;
+    }
+
+    void SlabSolver::sendReceive(const size_t boundary, std::vector<double>& lastSent, const int destination,
+                                 const int source, std::vector<std::pair<size_t, double>>& received)
+    {
+        std::vector<uint64_t> indexes;
+        std::vector<double> values;
+        if (destination != MPI_PROC_NULL)
+        {
+            const size_t offset = (boundary - firstStored) * layerSize;
+            for (size_t c = 0; c < layerSize; c++)
+            {
+                if (res[offset + c] < lastSent[c])
+                {
+                    indexes.push_back(c);
+                    values.push_back(res[offset + c]);
+                    lastSent[c] = res[offset + c];
+                }
+            }
+        }
+
+        uint64_t count = indexes.size();
+        uint64_t inCount = 0;
+        MPI_Sendrecv(&count, 1, MPI_UINT64_T, destination, TAG_GHOST,
+                     &inCount, 1, MPI_UINT64_T, source, TAG_GHOST, comm, MPI_STATUS_IGNORE);
+        std::vector<uint64_t> inIndexes(inCount);
+        std::vector<double> inValues(inCount);
+        MPI_Sendrecv(indexes.data(), static_cast<int>(count), MPI_UINT64_T, destination, TAG_GHOST,
+                     inIndexes.data(), static_cast<int>(inCount), MPI_UINT64_T, source, TAG_GHOST, comm, MPI_STATUS_IGNORE);
+        MPI_Sendrecv(values.data(), static_cast<int>(count), MPI_DOUBLE, destination, TAG_GHOST,
+                     inValues.data(), static_cast<int>(inCount), MPI_DOUBLE, source, TAG_GHOST, comm, MPI_STATUS_IGNORE);
+
+        received.clear();
+        for (size_t u = 0; u < inCount; u++)
+            received.push_back(std::make_pair(static_cast<size_t>(inIndexes[u]), inValues[u]));
+    }
+
+    size_t SlabSolver::local(const size_t cell) const
+    {
+        return cell - firstStored * layerSize;
+    }
+
+    size_t SlabSolver::global(const size_t id) const
+    {
+        return id + firstStored * layerSize;
+    }
+
+    int SlabSolver::owner(const size_t cell) const
+    {
+        // The layers of the process r start at r*nLayers/commSize
+        const size_t layer = layerOf(cell);
+        const size_t p = static_cast<size_t>(commSize);
+        size_t r = std::min(p - 1, layer * p / nLayers);
+        while (r > 0 && r * nLayers / p > layer)
+            r--;
+        while (r + 1 < p && (r + 1) * nLayers / p <= layer)
+            r++;
+        return static_cast<int>(r);
+    }
+
+    size_t SlabSolver::layerOf(const size_t cell) const
+    {
+        return cell / layerSize;
+    }
+
+    void SlabSolver::setValue(const size_t i, const size_t j, const size_t k, const double value)
+    {
+        const size_t rx = gridPtr->resx();
+        const size_t ry = gridPtr->resy();
+        const size_t rz = gridPtr->resz();
+        for (size_t z = rz * k; z < rz * (k + 1); z++)
+            for (size_t y = ry * j; y < ry * (j + 1); y++)
+            {
+                const size_t layer = gridPtr->nz() > 1 ? z : y;
+                if (layer < firstStored || layer >= firstStored + nStored)
+                    continue;
+                for (size_t x = rx * i; x < rx * (i + 1); x++)
+                    conductivity[local(gridPtr->mergeIds(x, y, z))] = value;
+            }
+    }
+
+}
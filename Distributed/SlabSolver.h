@@ -0,0 +1,159 @@
+/**
+* @file SlabSolver.h
+* @brief Domain decomposed minimum hydraulic resistance on several MPI processes
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_SLABSOLVER_H
+#define LMA_SLABSOLVER_H
+
+#include <mpi.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <utility>
+#include <istream>
+#include <ostream>
+#include <limits>
+#include <CartesianGrid.h>
+#include <TileFile.h>
+
+namespace lma {
+
+    /**
+     * The layers of the grid (z, or y on 2D grids) are split into one slab of consecutive layers
+     * per process, so each process stores the conductivity and the resistances of its slab and of
+     * one ghost layer on each side (the stencil reaches the next layer only). A round is:
+     *  1. label correcting Dijkstra on the slab, seeded with the cells whose resistance decreased
+     *     (the sources in the first round, the ghost cells updated by the neighbors later);
+     *  2. the cells of the first and last layers whose resistance decreased since the previous
+     *     round are sent to the neighbors, which store them in their ghost layers;
+     *  3. the rounds stop when no process received a smaller resistance.
+     * Every cell ends with the resistance of the best path of the whole graph, the same as LazyMole.
+     * The predecessors are global cell ids, the paths are followed from process to process.
+     * The methods that communicate are collective: all the processes must call them.
+     */
+    class SlabSolver {
+
+    public:
+
+        SlabSolver(const mla::CartesianGrid* grid, MPI_Comm comm);
+
+        int rank() const { return commRank; };
+        int size() const { return commSize; };
+
+        // Layers of this process: first and one past the last
+        size_t firstLayer() const { return first; };
+        size_t lastLayer() const { return last; };
+
+        bool owns(const size_t cell) const;
+
+        // Conductivity of the slab and of the ghost layers from the text layout of field.dat:
+        // every process parses the whole text and keeps its part
+        void loadField(std::istream& inStream, const size_t nSkip, const bool isLog);
+
+        // Same from a tile file: only the tiles that intersect the slab are read
+        void loadField(const TileFile& file, const bool isLog);
+
+        // Sources of the whole grid (each process keeps its own)
+        void setSources(const std::vector<size_t>& cells);
+
+        // Collective. Returns the number of rounds.
+        size_t run();
+
+        // Resistance of a cell of the slab (largest double if not reached)
+        double resistance(const size_t cell) const;
+
+        // Collective: smallest resistance among the targets and its target (numberOfCells if none reached)
+        std::pair<double, size_t> best(const std::vector<size_t>& targets) const;
+
+        // Collective: the resistance map is written by the process 0 one slab at a time, dense
+        // (one value per cell) or sparse ("cell value" lines of the reached cells)
+        void exportResistance(std::ostream* outStream, const bool sparse) const;
+
+        // Collective: cells of the least resistance path from cell back to its source, on the process 0
+        std::vector<size_t> pathCells(const size_t cell) const;
+
+        // Collective: "x,y,z" lines of the path written by the process 0
+        void exportPath(const size_t cell, std::ostream* outStream) const;
+
+    private:
+
+        // Relax the slab from the queued cells
+        void relax(std::vector<std::pair<double, size_t>>& heap);
+
+        // Send the decreased boundary cells to the neighbors, queue the ghost cells that decreased.
+        // True if any ghost cell decreased.
+        bool exchange(std::vector<std::pair<double, size_t>>& heap);
+
+        // Send the decreased cells of a boundary layer to destination and receive the ones of source
+        // (pairs of index in the layer and resistance)
+        void sendReceive(const size_t boundary, std::vector<double>& lastSent, const int destination,
+                         const int source, std::vector<std::pair<size_t, double>>& received);
+
+        // Local index of a cell of the slab or of the ghost layers
+        size_t local(const size_t cell) const;
+        size_t global(const size_t id) const;
+
+        int owner(const size_t cell) const;
+        size_t layerOf(const size_t cell) const;
+
+        void setValue(const size_t i, const size_t j, const size_t k, const double value);
+
+        const mla::CartesianGrid* gridPtr;
+        MPI_Comm comm;
+        int commRank;
+        int commSize;
+
+        // Layers along z (y on 2D grids), cells per layer, refinement along the layers
+        size_t nLayers;
+        size_t layerSize;
+        size_t layerRes;
+        size_t first;
+        size_t last;
+        // First layer stored (first - 1 unless first = 0)
+        size_t firstStored;
+        size_t nStored;
+
+        std::vector<double> conductivity;
+        std::vector<double> res;
+        std::vector<uint64_t> previous;
+        std::vector<size_t> sources;
+
+        // Stencil: offset of the neighbor in local indexes, offset in cells, distance between the centers
+        struct Neighbor {
+            long shift;
+            std::array<int, 3> offset;
+            double dist;
+        };
+        std::vector<Neighbor> stencil;
+
+        // Resistances of the first and last layers sent to the neighbors
+        std::vector<double> sentFirst;
+        std::vector<double> sentLast;
+
+        const double INF = std::numeric_limits<double>::max();
+        const uint64_t EMPTY = std::numeric_limits<uint64_t>::max();
+
+    };
+}
+
+#endif //LMA_SLABSOLVER_H
@@ -0,0 +1,193 @@
+/**
+* @file mainMPI.cpp
+* @brief Entry point for the domain decomposed lazymole (run with mpirun -np N lazyMoleMPI path/to/root)
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <mpi.h>
+#include <iostream>
+#include <stdexcept>
+#include <memory>
+#include <limits>
+#include <CartesianGrid.h>
+#include <Input.h>
+#include <Streams.h>
+#include <Regions.h>
+#include <TileFile.h>
+#include "SlabSolver.h"
+
+void run(int argc, char** argv)
+{
+    const double tStart = MPI_Wtime();
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (argc != 2)
+    {
+        throw std::runtime_error("ERROR: usage: mpirun -np N lazyMoleMPI path/to/root");
+    }
+    std::string configPath = argv[1];
+    if (configPath.back() != '/' && configPath.back() != '\\')
+    {
+        configPath.push_back('/');
+    }
+    lma::Input config(configPath + "config.yaml");
+
+    // Only the process 0 prints the messages and writes the outputs. An output named '-'
+    // uses the standard output, the messages then go to the standard error.
+    std::streambuf* coutBuffer = std::cout.rdbuf();
+    std::ostream protocolStream(coutBuffer);
+    if (lma::isStandardStream(config.outputRes()) && lma::isStandardStream(config.outputPath()))
+    {
+        throw std::runtime_error("ERROR: only one output can use the standard output ('-')");
+    }
+    if (rank != 0)
+    {
+        std::cout.rdbuf(nullptr);
+    }
+    else if (lma::isStandardStream(config.outputRes()) || lma::isStandardStream(config.outputPath()))
+    {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
+    // The options that need the whole grid in one process are not available
+    if (config.hasMaskFile() || config.hasMaskThreshold())
+    {
+        throw std::runtime_error("ERROR: the distributed solver does not support masks");
+    }
+    if (config.hasMultilevel() || config.hasFlowCorridor() || config.hasEnsemble() || config.hasConnectivity() ||
+        config.hasCache() || config.hasCheckpoint() || config.queue() != "heap" ||
+        config.stopAtTargets() || config.maxResistance() < std::numeric_limits<double>::max() ||
+        config.hasOutputPaths() || config.hasOutputLabels() || config.hasOutputLabelTargets() ||
+        config.hasOutputSensitivity())
+    {
+        std::cerr << (rank == 0 ? "WARNING: only the resistance map and the least resistance path are computed by "
+                                  "the distributed solver, the other solver and output options are not used\n" : "")
+                  << std::flush;
+    }
+    const std::string fieldName = lma::resolvePath(configPath, config.field());
+    if (lma::isStandardStream(fieldName) || lma::isSharedMemory(fieldName))
+    {
+        throw std::runtime_error("ERROR: every process of the distributed solver reads the field, it must be a file");
+    }
+
+    std::cout << "Running on " << size << " processes" << std::endl;
+
+    // Define grid
+    std::cout << "Preparing grid... " << std::flush;
+    mla::CartesianGrid grid(config.nx(), config.ny(), config.nz(), config.dx(), config.dy(), config.dz(),
+                            config.refx(), config.refy(), config.refz());
+    grid.setStencil(mla::stencilFromConnectivity(config.connectivity(), grid.nz() == 1));
+    lma::SlabSolver solver(&grid, MPI_COMM_WORLD);
+    std::cout << "OK!" << std::endl;
+
+    std::cout << "Loading source cells... " << std::flush;
+    const auto ids = lma::loadRegion(config, "source", configPath, &grid);
+    std::cout << "OK! (" << ids.size() << " cells)" << std::endl;
+
+    std::cout << "Loading target cells... " << std::flush;
+    const auto idsTarget = lma::loadRegion(config, "target", configPath, &grid);
+    std::cout << "OK! (" << idsTarget.size() << " cells)" << std::endl;
+
+    // Each process keeps its slab of the field
+    std::cout << "Loading field from '" << fieldName << "'... " << std::flush;
+    if (fieldName.size() > 4 && fieldName.compare(fieldName.size() - 4, 4, ".lmt") == 0)
+    {
+        lma::TileFile tileFile(fieldName);
+        solver.loadField(tileFile, config.fieldLog());
+    }
+    else
+    {
+        lma::InputStream inStream(fieldName);
+        solver.loadField(inStream.get(), config.fieldSkip(), config.fieldLog());
+    }
+    std::cout << "OK!" << std::endl;
+
+    std::cout << "Running algorithm... " << std::flush;
+    MPI_Barrier(MPI_COMM_WORLD);
+    const double t1 = MPI_Wtime();
+    solver.setSources(ids);
+    const size_t nRounds = solver.run();
+    const double t2 = MPI_Wtime();
+    std::cout << "OK!" << std::endl;
+    std::cout << "Rounds of ghost layer exchanges = " << nRounds << std::endl;
+
+    // Output (written by the process 0)
+    if (config.outputResFormat() != "sparse" && config.outputResFormat() != "dense")
+    {
+        throw std::runtime_error("ERROR: unknown resistance format '" + config.outputResFormat() + "' (use 'dense' or 'sparse')");
+    }
+    const std::string resName = lma::resolvePath(configPath, config.outputRes());
+    std::cout << "Exporting resistance map to '" << resName << "'... " << std::flush;
+    {
+        std::unique_ptr<lma::OutputStream> outStream(rank == 0 ? new lma::OutputStream(resName, protocolStream) : nullptr);
+        solver.exportResistance(outStream ? &outStream->get() : nullptr, config.outputResFormat() == "sparse");
+        if (outStream)
+        {
+            outStream->close();
+        }
+    }
+    std::cout << "OK!" << std::endl;
+
+    const auto best = solver.best(idsTarget);
+    if (best.second == grid.numberOfCells())
+    {
+        std::cerr << (rank == 0 ? "WARNING: no target cell has been reached, the least resistance path is not exported\n" : "")
+                  << std::flush;
+    }
+    else
+    {
+        std::cout << "Minimum Hydraulic Resistance = " << best.first << std::endl;
+        std::cout << "Target ID = " << best.second << std::endl;
+
+        const std::string pathName = lma::resolvePath(configPath, config.outputPath());
+        std::cout << "Exporting least resistance path to '" << pathName << "'... " << std::flush;
+        std::unique_ptr<lma::OutputStream> outStream(rank == 0 ? new lma::OutputStream(pathName, protocolStream) : nullptr);
+        solver.exportPath(best.second, outStream ? &outStream->get() : nullptr);
+        if (outStream)
+        {
+            outStream->close();
+        }
+        std::cout << "OK!" << std::endl;
+    }
+
+    std::cout << std::endl;
+    std::cout << "Time elapsed = " << MPI_Wtime() - tStart << "s (LM time = " << t2 - t1 << "s)" << std::endl;
+    std::cout << std::endl;
+    std::cout.rdbuf(coutBuffer);
+}
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    try
+    {
+        run(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << std::endl << e.what() << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+}
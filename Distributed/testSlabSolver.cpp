@@ -0,0 +1,140 @@
+/**
+* @file testSlabSolver.cpp
+* @brief Check the distributed solver against LazyMole (run with mpirun -np N testSlabSolver)
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <mpi.h>
+#include <iostream>
+#include <sstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <CartesianGrid.h>
+#include <CellField.h>
+#include <LazyMole.h>
+#include "SlabSolver.h"
+
+// Random logK field (the same on every process), sources on the first layer and targets on the last one.
+// Returns the number of failed checks on this process.
+int check(const std::string& name, const size_t nx, const size_t ny, const size_t nz, const size_t ref,
+          const size_t connectivity)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    mla::CartesianGrid grid(nx, ny, nz, 1.0, 0.5, 2.0, ref, ref, nz > 1 ? ref : 1);
+    grid.setStencil(mla::stencilFromConnectivity(connectivity, nz == 1));
+
+    std::mt19937 generator(42);
+    std::normal_distribution<double> logK(0., 1.5);
+    std::stringstream text;
+    for (size_t i = 0; i < nx * ny * nz; i++)
+        text << logK(generator) << '\n';
+
+    const size_t nLayers = nz > 1 ? grid.nz() : grid.ny();
+    const size_t layerSize = grid.numberOfCells() / nLayers;
+    std::vector<size_t> sources;
+    std::vector<size_t> targets;
+    for (size_t c = 0; c < layerSize; c += 3)
+    {
+        sources.push_back(c);
+        targets.push_back((nLayers - 1) * layerSize + c);
+    }
+
+    // Reference on the whole grid
+    mla::ConductivityField conductivity(&grid);
+    std::stringstream copy(text.str());
+    conductivity.import(copy, 0, 1.0, true);
+    mla::LazyMole lazyMole(&grid, conductivity, sources);
+    auto reference = lazyMole.run();
+
+    lma::SlabSolver solver(&grid, MPI_COMM_WORLD);
+    solver.loadField(text, 0, true);
+    solver.setSources(sources);
+    const size_t nRounds = solver.run();
+
+    int nFailed = 0;
+    double maxError = 0.;
+    for (size_t cell = 0; cell < grid.numberOfCells(); cell++)
+    {
+        if (!solver.owns(cell))
+            continue;
+        const double expected = reference->getFromCell(cell);
+        maxError = std::max(maxError, std::abs(solver.resistance(cell) - expected) / expected);
+    }
+    if (maxError > 1e-12)
+    {
+        std::cerr << name << ": process " << rank << " relative error " << maxError << std::endl;
+        nFailed++;
+    }
+
+    // Best target and path (no ties with a continuous random field)
+    const auto best = solver.best(targets);
+    double expectedRes = std::numeric_limits<double>::max();
+    size_t expectedTarget = grid.numberOfCells();
+    for (auto cell : targets)
+    {
+        if (reference->getFromCell(cell) < expectedRes)
+        {
+            expectedRes = reference->getFromCell(cell);
+            expectedTarget = cell;
+        }
+    }
+    const auto path = solver.pathCells(best.second);
+    if (rank == 0)
+    {
+        if (best.second != expectedTarget || std::abs(best.first - expectedRes) > 1e-12 * expectedRes)
+        {
+            std::cerr << name << ": best target " << best.second << " instead of " << expectedTarget << std::endl;
+            nFailed++;
+        }
+        if (path != lazyMole.pathCells(expectedTarget))
+        {
+            std::cerr << name << ": the least resistance path differs" << std::endl;
+            nFailed++;
+        }
+        std::cout << name << ": " << nRounds << " rounds, MHR " << best.first
+                  << (nFailed == 0 ? " OK" : " FAILED") << std::endl;
+    }
+    return nFailed;
+}
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    int nFailed = 0;
+    try
+    {
+        nFailed += check("3D, 26 neighbors", 17, 13, 11, 1, 26);
+        nFailed += check("3D, 6 neighbors, refined", 9, 8, 7, 2, 6);
+        nFailed += check("2D, 8 neighbors", 40, 31, 1, 1, 8);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    int nTotal = 0;
+    MPI_Allreduce(&nFailed, &nTotal, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Finalize();
+    return nTotal == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
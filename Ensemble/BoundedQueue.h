@@ -0,0 +1,86 @@
+/**
+* @file BoundedQueue.h
+* @brief Blocking FIFO queue with a maximum size used between the stages of a pipeline
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_BOUNDEDQUEUE_H
+#define LMA_BOUNDEDQUEUE_H
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace lma
+{
+    template<typename T>
+    class BoundedQueue
+    {
+    public:
+
+        BoundedQueue(const size_t capacity) : capacity(capacity > 0 ? capacity : 1), isClosed(false) {}
+
+        // Wait until there is room for the item, false if the queue has been closed
+        bool push(T item)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [this]() { return items.size() < capacity || isClosed; });
+            if (isClosed)
+                return false;
+            items.push_back(std::move(item));
+            notEmpty.notify_one();
+            return true;
+        }
+
+        // Wait for an item, false if the queue has been closed and is empty
+        bool pop(T& item)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [this]() { return !items.empty() || isClosed; });
+            if (items.empty())
+                return false;
+            item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return true;
+        }
+
+        // No more items will be pushed: the consumers drain the remaining ones
+        void close()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isClosed = true;
+            notEmpty.notify_all();
+            notFull.notify_all();
+        }
+
+    private:
+
+        size_t capacity;
+        bool isClosed;
+        std::deque<T> items;
+        std::mutex mutex;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+    };
+}
+
+#endif //LMA_BOUNDEDQUEUE_H
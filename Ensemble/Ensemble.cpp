@@ -0,0 +1,212 @@
+/**
+* @file Ensemble.cpp
+* @brief Pipelined execution of many realizations of the conductivity field
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <limits>
+#include <algorithm>
+#include <tuple>
+#include "Ensemble.h"
+
+namespace lma
+{
+    Ensemble::Ensemble(mla::CartesianGrid* grid, const mla::ActiveCells* active,
+                       const std::vector<size_t>& sourceIds, const std::vector<size_t>& targetIds,
+                       const EnsembleSettings& settings)
+            : gridPtr(grid), activePtr(active), sources(sourceIds), targets(targetIds), settings(settings)
+    {
+        if (this->settings.nWorkers == 0)
+            this->settings.nWorkers = 1;
+    }
+
+    void Ensemble::setConfigure(const std::function<void(mla::LazyMole&)>& configureSolver)
+    {
+        configure = configureSolver;
+    }
+
+    std::string Ensemble::fileName(const std::string& pattern, const size_t index)
+    {
+        std::string name = pattern;
+        const std::string number = std::to_string(index);
+        size_t pos;
+        while ((pos = name.find("{}")) != std::string::npos)
+        {
+            name.replace(pos, 2, number);
+        }
+        return name;
+    }
+
+    void Ensemble::run()
+    {
+        fields.reset(new BoundedQueue<Realization>(settings.queueSize));
+        solutions.reset(new BoundedQueue<Solution>(settings.queueSize));
+        error = nullptr;
+
+        std::thread loader(&Ensemble::load, this);
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < settings.nWorkers; i++)
+        {
+            workers.emplace_back(&Ensemble::solve, this);
+        }
+        std::thread writer(&Ensemble::write, this);
+
+        loader.join();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        solutions->close();
+        writer.join();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    void Ensemble::fail()
+    {
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+                error = std::current_exception();
+        }
+        fields->close();
+        solutions->close();
+    }
+
+    void Ensemble::load()
+    {
+        try
+        {
+            for (size_t index = settings.first; index < settings.first + settings.count; index++)
+            {
+                const std::string name = fileName(settings.fieldFile, index);
+                std::ifstream inStream;
+                inStream.open(name, std::ifstream::in);
+                if (!inStream)
+                {
+                    throw std::runtime_error("ERROR: cannot find the field file " + name);
+                }
+
+                Realization realization;
+                realization.index = index;
+                realization.field.reset(new mla::ConductivityField(gridPtr));
+                realization.field->import(inStream, settings.fieldSkip, 1.0, settings.fieldLog);
+                inStream.close();
+
+                if (!fields->push(std::move(realization)))
+                    break;
+            }
+            fields->close();
+        }
+        catch (...)
+        {
+            fail();
+        }
+    }
+
+    void Ensemble::solve()
+    {
+        try
+        {
+            Realization realization;
+            while (fields->pop(realization))
+            {
+                Solution solution;
+                solution.index = realization.index;
+                solution.lazyMole.reset(new mla::LazyMole(gridPtr, *realization.field, sources, activePtr));
+                // The solver keeps its own copy of the conductivity
+                realization.field.reset();
+                if (configure)
+                    configure(*solution.lazyMole);
+                solution.lazyMole->run();
+
+                if (!solutions->push(std::move(solution)))
+                    break;
+            }
+        }
+        catch (...)
+        {
+            fail();
+        }
+    }
+
+    void Ensemble::write()
+    {
+        try
+        {
+            std::vector<std::tuple<size_t, double, size_t>> summary;
+            Solution solution;
+            while (solutions->pop(solution))
+            {
+                auto smallestRes = solution.lazyMole->resistance();
+                if (!settings.resistanceFile.empty())
+                {
+                    const std::string name = fileName(settings.resistanceFile, solution.index);
+                    if (settings.sparse)
+                        smallestRes->exportSparseToFile(name, std::numeric_limits<double>::max());
+                    else
+                        smallestRes->exportToFile(name);
+                }
+
+                double minRes = std::numeric_limits<double>::max();
+                size_t minId = gridPtr->numberOfCells();
+                for (auto id : targets)
+                {
+                    if (smallestRes->getFromCell(id) < minRes)
+                    {
+                        minId = id;
+                        minRes = smallestRes->getFromCell(id);
+                    }
+                }
+                if (!settings.pathFile.empty() && minId != gridPtr->numberOfCells())
+                {
+                    solution.lazyMole->exportPath(minId, fileName(settings.pathFile, solution.index));
+                }
+                summary.emplace_back(solution.index, minRes, minId);
+                solution.lazyMole.reset();
+            }
+
+            if (!settings.summaryFile.empty())
+            {
+                std::sort(summary.begin(), summary.end());
+                std::ofstream outStream;
+                outStream.open(settings.summaryFile);
+                if (!outStream)
+                {
+                    throw std::runtime_error("ERROR: cannot open the file " + settings.summaryFile);
+                }
+                outStream.precision(std::numeric_limits<double>::digits10);
+                for (auto& line : summary)
+                {
+                    outStream << std::get<0>(line) << " " << std::get<1>(line) << " " << std::get<2>(line) << std::endl;
+                }
+                outStream.close();
+            }
+        }
+        catch (...)
+        {
+            fail();
+        }
+    }
+}
@@ -0,0 +1,120 @@
+/**
+* @file Ensemble.h
+* @brief Pipelined execution of many realizations of the conductivity field
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_ENSEMBLE_H
+#define LMA_ENSEMBLE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <exception>
+#include <functional>
+#include <CellField.h>
+#include <ActiveCellField.h>
+#include <LazyMole.h>
+#include "BoundedQueue.h"
+
+namespace lma
+{
+    struct EnsembleSettings
+    {
+        EnsembleSettings() : first(0), count(0), fieldSkip(0), fieldLog(true), sparse(false),
+                             nWorkers(1), queueSize(1) {}
+
+        // In the file names "{}" is replaced by the index of the realization
+        size_t first;
+        size_t count;
+        std::string fieldFile;
+        size_t fieldSkip;
+        bool fieldLog;
+        std::string resistanceFile; // Empty to skip the resistance maps
+        std::string pathFile;       // Empty to skip the paths
+        std::string summaryFile;    // "realization mhr target" lines
+        bool sparse;                // Sparse resistance maps
+
+        size_t nWorkers;            // Solver threads
+        size_t queueSize;           // Maximum number of realizations waiting between two stages
+    };
+
+    /**
+     * Three stages connected by bounded queues: a loader thread parses the fields, a pool of
+     * workers runs LazyMole and a writer thread exports the results. At most
+     * 2*queueSize+nWorkers+2 realizations are in memory at the same time and the throughput
+     * is limited by the slowest stage.
+     */
+    class Ensemble
+    {
+    public:
+
+        Ensemble(mla::CartesianGrid* grid, const mla::ActiveCells* active,
+                 const std::vector<size_t>& sourceIds, const std::vector<size_t>& targetIds,
+                 const EnsembleSettings& settings);
+
+        // Applied to each solver before running it (termination criteria, queue...)
+        void setConfigure(const std::function<void(mla::LazyMole&)>& configureSolver);
+
+        void run();
+
+        // Replace "{}" with the index
+        static std::string fileName(const std::string& pattern, const size_t index);
+
+    private:
+
+        struct Realization
+        {
+            size_t index;
+            std::unique_ptr<mla::ConductivityField> field;
+        };
+
+        struct Solution
+        {
+            size_t index;
+            std::unique_ptr<mla::LazyMole> lazyMole;
+        };
+
+        void load();
+
+        void solve();
+
+        void write();
+
+        void fail();
+
+        mla::CartesianGrid* gridPtr;
+        const mla::ActiveCells* activePtr;
+        std::vector<size_t> sources;
+        std::vector<size_t> targets;
+        EnsembleSettings settings;
+        std::function<void(mla::LazyMole&)> configure;
+
+        std::unique_ptr<BoundedQueue<Realization>> fields;
+        std::unique_ptr<BoundedQueue<Solution>> solutions;
+
+        std::mutex errorMutex;
+        std::exception_ptr error;
+    };
+}
+
+#endif //LMA_ENSEMBLE_H
@@ -0,0 +1,237 @@
+/**
+* @file ActiveCellField.h
+* @brief Compressed indexing of the active cells of a grid and fields
+*        defined only on the active cells
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_ACTIVECELLFIELD_H
+#define LMA_ACTIVECELLFIELD_H
+
+#include <cstddef>
+#include <vector>
+#include <limits>
+#include <fstream>
+#include <stdexcept>
+#include <CellField.h>
+#include "Field.h"
+
+namespace mla {
+
+    /**
+     * Map between the cells of a grid and a compact index of the active cells.
+     * When no mask is given all the cells are active and the map is the identity.
+     */
+    class ActiveCells {
+
+    public:
+
+        static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+        ActiveCells(Grid* grid) : gridPtr(grid), all(true), nActive(grid->numberOfCells()) {};
+
+        ActiveCells(Grid* grid, const std::vector<char>& mask) : gridPtr(grid), all(false), nActive(0) {
+            if (mask.size() != grid->numberOfCells()) {
+                throw std::runtime_error("ERROR: the mask does not match the number of cells of the grid");
+            }
+
+            cellToIndex.assign(mask.size(), std::numeric_limits<size_t>::max());
+            for (size_t cell = 0; cell < mask.size(); cell++) {
+                if (mask[cell]) {
+                    cellToIndex[cell] = nActive++;
+                    indexToCell.push_back(cell);
+                }
+            }
+        };
+
+        Grid* grid() const {
+            return gridPtr;
+        };
+
+        bool isAll() const {
+            return all;
+        };
+
+        // Number of active cells
+        size_t size() const {
+            return nActive;
+        };
+
+        bool isActive(const size_t cell) const {
+            return all || cellToIndex[cell] != NONE;
+        };
+
+        // Compact index of a cell (NONE if the cell is inactive)
+        size_t index(const size_t cell) const {
+            return all ? cell : cellToIndex[cell];
+        };
+
+        // Cell of a compact index
+        size_t cell(const size_t index) const {
+            return all ? index : indexToCell[index];
+        };
+
+    private:
+
+        Grid* gridPtr;
+        bool all;
+        size_t nActive;
+        std::vector<size_t> cellToIndex;
+        std::vector<size_t> indexToCell;
+
+    };
+
+
+    /**
+     * Field storing one value per active cell. Inactive cells are expanded
+     * with a fixed value only when reading by cell or exporting to file.
+     */
+    template<typename C>
+    class ActiveCellField : public Field<C> {
+
+    public:
+
+        ActiveCellField(const ActiveCells* active, C value = C(), C inactiveValue = C())
+                : Field<C>(active->grid(), active->size(), value),
+                  activePtr(active), inactive(inactiveValue) {};
+
+        const ActiveCells* activeCells() const {
+            return activePtr;
+        };
+
+        C getFromCell(const size_t cell) const {
+            const size_t id = activePtr->index(cell);
+            return id != ActiveCells::NONE ? this->values[id] : inactive;
+        };
+
+        void exportToFile(const std::string fileName) const {
+            std::ofstream outStream;
+            outStream.open(fileName);
+
+            if (!outStream) {
+                throw std::runtime_error("ERROR: cannot open the file " + fileName);
+            }
+
+            exportToStream(outStream);
+            outStream.close();
+        };
+
+        void exportToStream(std::ostream& outStream) const {
+            const size_t nCells = this->gridPtr->numberOfCells();
+            for (size_t cell = 0; cell < nCells; cell++) {
+                outStream << getFromCell(cell) << '\n';
+            }
+        };
+
+        // Write only the cells whose value differs from skipValue, as "cell value" pairs
+        void exportSparseToFile(const std::string fileName, const C skipValue) const {
+            std::ofstream outStream;
+            outStream.open(fileName);
+
+            if (!outStream) {
+                throw std::runtime_error("ERROR: cannot open the file " + fileName);
+            }
+
+            exportSparseToStream(outStream, skipValue);
+            outStream.close();
+        };
+
+        void exportSparseToStream(std::ostream& outStream, const C skipValue) const {
+            for (size_t id = 0; id < this->values.size(); id++) {
+                if (this->values[id] != skipValue) {
+                    outStream << activePtr->cell(id) << " " << this->values[id] << '\n';
+                }
+            }
+        };
+
+    private:
+
+        const ActiveCells* activePtr;
+        C inactive;
+
+    };
+
+
+    /**
+     * Mask of the active cells (1 active, 0 inactive).
+     */
+    class MaskField : public CellField<char> {
+
+    public:
+
+        MaskField(CartesianGrid* grid, char value = 1)
+                : CellField<char>(grid, value) {};
+
+        // Same layout as ConductivityField::import: one value per (unrefined) cell, non-zero is active
+        void import(std::istream& inStream, const size_t nSkip = 0) {
+            char line[256];
+            for (size_t i = 0; i < nSkip; i++) {
+                inStream.getline(line, 256);
+            }
+
+            CartesianGrid* cGrid = (CartesianGrid*) gridPtr;
+
+            for (size_t k = 0; k < cGrid->nz()/cGrid->resz(); k++)
+                for (size_t j = 0; j < cGrid->ny()/cGrid->resy(); j++)
+                    for (size_t i = 0; i < cGrid->nx()/cGrid->resx(); i++) {
+                        double val;
+                        inStream >> val;
+
+                        if (inStream.eof()) {
+                            std::cerr << "WARNING: not enough values in iStream for the mask" << std::endl;
+                            break;
+                        }
+
+                        for (size_t x = cGrid->resx()*i; x < cGrid->resx()*(i+1); x++)
+                            for (size_t y = cGrid->resy()*j; y < cGrid->resy()*(j+1); y++)
+                                for (size_t z = cGrid->resz()*k; z < cGrid->resz()*(k+1); z++) {
+                                    size_t id = cGrid->mergeIds(x,y,z);
+                                    this->values[id] = (val != 0.) ? 1 : 0;
+                                }
+                    }
+        }
+
+        // Deactivate the cells with conductivity below kMin
+        void threshold(const CellField<double>& conductivity, const double kMin) {
+            for (size_t id = 0; id < this->values.size(); id++) {
+                if (conductivity.getFromCell(id) < kMin) {
+                    this->values[id] = 0;
+                }
+            }
+        }
+
+        std::vector<char> mask() const {
+            return std::vector<char>(this->values.begin(), this->values.end());
+        }
+
+        size_t numberOfActive() const {
+            size_t n = 0;
+            for (auto v : this->values) {
+                n += v ? 1 : 0;
+            }
+            return n;
+        }
+
+    };
+
+}
+
+
+#endif //LMA_ACTIVECELLFIELD_H
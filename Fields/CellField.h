@@ -7,6 +7,7 @@
 
 #include <cstddef>
 #include <stdexcept>
+#include <string>
 #include <fstream>
 #include <iostream>
 #include <assert.h>
@@ -37,10 +38,14 @@ namespace mla {
                 throw std::runtime_error("ERROR: ERROR: cannot open the file" + fileName);
             }
 
+            exportToStream(outStream);
+            outStream.close();
+        };
+
+        void exportToStream(std::ostream& outStream) const {
             for (auto v : this->values) {
-                outStream << v << std::endl;
+                outStream << v << '\n';
             }
-            outStream.close();
         };
 
     };
@@ -103,6 +108,27 @@ namespace mla {
 
         }
 
+        // Raw values (e.g. a shared memory segment), one per unrefined cell in the same order as import
+        void import(const double* data, const size_t n, bool isLog = true) {
+            CartesianGrid* cGrid = (CartesianGrid*) gridPtr;
+            const size_t nCoarse = (cGrid->nx()/cGrid->resx()) * (cGrid->ny()/cGrid->resy()) * (cGrid->nz()/cGrid->resz());
+            if (n != nCoarse) {
+                throw std::runtime_error("ERROR: " + std::to_string(n) + " conductivity values for " +
+                                         std::to_string(nCoarse) + " cells");
+            }
+
+            size_t index = 0;
+            for (size_t k = 0; k < cGrid->nz()/cGrid->resz(); k++)
+                for (size_t j = 0; j < cGrid->ny()/cGrid->resy(); j++)
+                    for (size_t i = 0; i < cGrid->nx()/cGrid->resx(); i++) {
+                        const double val = isLog ? std::exp(data[index++]) : data[index++];
+                        for (size_t x = cGrid->resx()*i; x < cGrid->resx()*(i+1); x++)
+                            for (size_t y = cGrid->resy()*j; y < cGrid->resy()*(j+1); y++)
+                                for (size_t z = cGrid->resz()*k; z < cGrid->resz()*(k+1); z++)
+                                    this->values[cGrid->mergeIds(x,y,z)] = val;
+                    }
+        }
+
     };
 
 }
@@ -7,7 +7,9 @@
 
 #include <cstddef>
 #include <vector>
+#include <algorithm>
 #include <Grid.h>
+#include "FieldAllocator.h"
 #include <iostream>
 
 
@@ -19,8 +21,11 @@ namespace mla {
     public:
 
         // Constructors
+        // The values are first touched by the threads of the memory policy
         Field(Grid* grid, size_t dof, C value) :
-                gridPtr(grid), values(dof, value) {};
+                gridPtr(grid), values(dof) {
+            parallelFill(values, value);
+        };
 
         // Destructor
         virtual ~Field() {};
@@ -42,6 +47,10 @@ namespace mla {
             values[id] = val;
         }
 
+        virtual void fill(const C val) {
+            parallelFill(values, val);
+        }
+
         // Operators
         C operator [](size_t id) const {
             return values[id];
@@ -55,7 +64,7 @@ namespace mla {
     protected:
 
         Grid* gridPtr;
-        std::vector<C> values;
+        std::vector<C, FieldAllocator<C>> values;
 
     };
 }
@@ -0,0 +1,265 @@
+/**
+* @file FieldAllocator.h
+* @brief Allocator of the values of the fields: huge pages, NUMA placement
+*        and parallel first touch of the large arrays
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_FIELDALLOCATOR_H
+#define LMA_FIELDALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace mla {
+
+    /**
+     * Process-wide placement of the arrays of the fields, set once (e.g. from config.yaml)
+     * before the fields are created. Arrays smaller than minBytes always use the heap.
+     *  pages:     SMALL (heap), TRANSPARENT (madvise MADV_HUGEPAGE) or HUGE (MAP_HUGETLB,
+     *             falls back to TRANSPARENT when no huge page is reserved)
+     *  placement: DEFAULT (first touch by the initializing threads) or INTERLEAVE (pages
+     *             spread over all the NUMA nodes with mbind)
+     *  threads:   threads initializing the large arrays, so that with DEFAULT placement the
+     *             pages are spread over the nodes of the threads (0 = number of cores)
+     */
+    struct MemoryPolicy {
+
+        enum Pages { SMALL, TRANSPARENT, HUGE };
+        enum Placement { DEFAULT, INTERLEAVE };
+
+        Pages pages = SMALL;
+        Placement placement = DEFAULT;
+        size_t threads = 1;
+        size_t minBytes = 2 * 1024 * 1024;
+
+        static MemoryPolicy& global() {
+            static MemoryPolicy policy;
+            return policy;
+        }
+
+        static Pages pagesFromString(const std::string& name) {
+            if (name == "small")
+                return SMALL;
+            if (name == "transparent")
+                return TRANSPARENT;
+            if (name == "huge")
+                return HUGE;
+            throw std::runtime_error("ERROR: unknown memory pages '" + name + "' (small, transparent or huge)");
+        }
+
+        static Placement placementFromString(const std::string& name) {
+            if (name == "default" || name == "first-touch")
+                return DEFAULT;
+            if (name == "interleave")
+                return INTERLEAVE;
+            throw std::runtime_error("ERROR: unknown memory placement '" + name +
+                                     "' (default, first-touch or interleave)");
+        }
+
+        size_t initThreads() const {
+            const size_t n = threads > 0 ? threads : std::thread::hardware_concurrency();
+            return n > 0 ? n : 1;
+        }
+
+        // True if an array of the given size is mapped and initialized according to the policy
+        bool isLarge(const size_t bytes) const {
+            return bytes >= minBytes && (pages != SMALL || placement != DEFAULT || initThreads() > 1);
+        }
+
+    };
+
+
+    /**
+     * Stateless allocator used by Field. Each block starts with a small header recording how
+     * it was obtained, so that the policy can change without breaking older blocks. Default
+     * construction of trivial values does nothing: the pages of the large arrays are first
+     * touched by parallelFill.
+     */
+    template<typename T>
+    class FieldAllocator {
+
+    public:
+
+        typedef T value_type;
+
+        template<typename U>
+        struct rebind {
+            typedef FieldAllocator<U> other;
+        };
+
+        FieldAllocator() {};
+
+        template<typename U>
+        FieldAllocator(const FieldAllocator<U>&) {};
+
+        T* allocate(const size_t n) {
+            if (n > (std::numeric_limits<size_t>::max() - HEADER) / sizeof(T))
+                throw std::bad_alloc();
+            const size_t bytes = n * sizeof(T) + HEADER;
+            char* block = nullptr;
+            size_t mapped = 0;
+#ifdef __linux__
+            const MemoryPolicy& policy = MemoryPolicy::global();
+            if (policy.isLarge(bytes))
+                block = map(bytes, policy, mapped);
+#endif
+            if (block == nullptr)
+                block = static_cast<char*>(::operator new(bytes));
+            *reinterpret_cast<size_t*>(block) = mapped;
+            return reinterpret_cast<T*>(block + HEADER);
+        }
+
+        void deallocate(T* p, size_t) {
+            if (p == nullptr)
+                return;
+            char* block = reinterpret_cast<char*>(p) - HEADER;
+            const size_t mapped = *reinterpret_cast<size_t*>(block);
+#ifdef __linux__
+            if (mapped > 0) {
+                munmap(block, mapped);
+                return;
+            }
+#endif
+            ::operator delete(block);
+        }
+
+        template<typename U>
+        void construct(U* p) {
+            ::new(static_cast<void*>(p)) U;
+        }
+
+        template<typename U, typename... Args>
+        void construct(U* p, Args&&... args) {
+            ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+        }
+
+    private:
+
+        // Keeps the alignment of the values
+        static const size_t HEADER = 64;
+
+#ifdef __linux__
+        static char* map(const size_t bytes, const MemoryPolicy& policy, size_t& mapped) {
+            const size_t HUGE_PAGE = 2 * 1024 * 1024;
+            void* block = MAP_FAILED;
+            MemoryPolicy::Pages pages = policy.pages;
+#ifdef MAP_HUGETLB
+            if (pages == MemoryPolicy::HUGE) {
+                mapped = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+                block = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (block == MAP_FAILED) {
+                    warnOnce("WARNING: no huge pages available (vm.nr_hugepages), using transparent huge pages");
+                    pages = MemoryPolicy::TRANSPARENT;
+                }
+            }
+#endif
+            if (block == MAP_FAILED) {
+                mapped = bytes;
+                block = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (block == MAP_FAILED) {
+                    mapped = 0;
+                    return nullptr;
+                }
+#ifdef MADV_HUGEPAGE
+                if (pages == MemoryPolicy::TRANSPARENT && madvise(block, mapped, MADV_HUGEPAGE) != 0)
+                    warnOnce("WARNING: transparent huge pages are not available");
+#endif
+            }
+#ifdef SYS_mbind
+            if (policy.placement == MemoryPolicy::INTERLEAVE) {
+                // MPOL_INTERLEAVE over the nodes listed by sysfs (up to 64)
+                const int MPOL_INTERLEAVE_MODE = 3;
+                unsigned long nodes = 0;
+                for (unsigned long node = 0; node < 64; node++) {
+                    const std::string path = "/sys/devices/system/node/node" + std::to_string(node);
+                    if (access(path.c_str(), F_OK) == 0)
+                        nodes |= 1UL << node;
+                }
+                if (nodes == 0 || syscall(SYS_mbind, block, mapped, MPOL_INTERLEAVE_MODE, &nodes, 65, 0) != 0)
+                    warnOnce("WARNING: cannot interleave the fields over the NUMA nodes");
+            }
+#endif
+            return static_cast<char*>(block);
+        }
+
+        static void warnOnce(const char* message) {
+            static std::atomic<bool> isWarned(false);
+            if (!isWarned.exchange(true))
+                std::cerr << message << std::endl;
+        }
+#endif
+
+    };
+
+    template<typename T, typename U>
+    bool operator==(const FieldAllocator<T>&, const FieldAllocator<U>&) {
+        return true;
+    }
+
+    template<typename T, typename U>
+    bool operator!=(const FieldAllocator<T>&, const FieldAllocator<U>&) {
+        return false;
+    }
+
+
+    // Fill the values in contiguous chunks, one per thread of the policy (first touch)
+    template<typename C, typename A>
+    void parallelFill(std::vector<C, A>& values, const C& value) {
+        const size_t n = values.size();
+        const MemoryPolicy& policy = MemoryPolicy::global();
+        const size_t nThreads = policy.isLarge(n * sizeof(C)) ? std::min(policy.initThreads(), n) : 1;
+        if (nThreads <= 1) {
+            std::fill(values.begin(), values.end(), value);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < nThreads; t++) {
+            const size_t begin = n * t / nThreads;
+            const size_t end = n * (t + 1) / nThreads;
+            workers.emplace_back([&values, &value, begin, end]() {
+                std::fill(values.begin() + begin, values.begin() + end, value);
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+}
+
+
+#endif //LMA_FIELDALLOCATOR_H
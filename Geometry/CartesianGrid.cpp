@@ -22,6 +22,9 @@
 */
 
 #include <sstream>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
 #include "CartesianGrid.h"
 
 namespace mla
@@ -34,7 +37,9 @@ namespace mla
             : _nx(resx*nx), _ny(resy*ny), _nz(resz*nz),
               _dx(dx/resx), _dy(dy/resy), _dz(dz/resz), _p0(p0), _is2d(false),
               _resx(resx), _resy(resy), _resz(resz)
-    { }
+    {
+        setStencil(FULL);
+    }
 
     CartesianGrid::CartesianGrid(const size_t nx, const size_t ny,
                                  const double dx, const double dy,
@@ -43,7 +48,9 @@ namespace mla
             : _nx(resx*nx), _ny(resy*ny), _nz(1),
               _dx(dx/resx), _dy(dy/resy), _dz(1.0), _p0(p0), _is2d(true),
               _resx(resx), _resy(resy), _resz(1)
-    { }
+    {
+        setStencil(FULL);
+    }
 
     size_t CartesianGrid::numberOfCells() const
     {
@@ -58,21 +65,59 @@ namespace mla
     std::vector<size_t> CartesianGrid::neighbors(const size_t id) const
     {
         std::vector<size_t> cells;
-        auto ids = this->splitId(id);
-        for (int s0 = -1; s0 <= 1; s0++)
-            for (int s1 = -1; s1 <= 1; s1++)
-                for (int s2 = -1; s2 <= 1; s2++) {
-                    if (ids[0]+s0 >= 0 && ids[0]+s0 < _nx &&
-                        ids[1]+s1 >= 0 && ids[1]+s1 < _ny &&
-                        ids[2]+s2 >= 0 && ids[2]+s2 < _nz) {
-                        if (!(s0==0 && s1==0 && s2==0)) {
-                            cells.push_back(this->mergeIds(ids[0]+s0, ids[1]+s1, ids[2]+s2));
-                        }
-                    }
+        cells.reserve(_offsets.size());
+        if (_nz == 1)
+        {
+            // 2D grid: the offsets have no z component
+            const long idx = static_cast<long>(id % _nx);
+            const long idy = static_cast<long>(id / _nx);
+            for (const auto& s : _offsets)
+            {
+                if (idx+s[0] >= 0 && idx+s[0] < static_cast<long>(_nx) &&
+                    idy+s[1] >= 0 && idy+s[1] < static_cast<long>(_ny))
+                {
+                    cells.push_back(id + s[1]*_nx + s[0]);
                 }
+            }
+            return cells;
+        }
+
+        auto ids = this->splitId(id);
+        const long idx = static_cast<long>(ids[0]);
+        const long idy = static_cast<long>(ids[1]);
+        const long idz = static_cast<long>(ids[2]);
+        for (const auto& s : _offsets)
+        {
+            if (idx+s[0] >= 0 && idx+s[0] < static_cast<long>(_nx) &&
+                idy+s[1] >= 0 && idy+s[1] < static_cast<long>(_ny) &&
+                idz+s[2] >= 0 && idz+s[2] < static_cast<long>(_nz))
+            {
+                cells.push_back(id + (s[2]*static_cast<long>(_ny) + s[1])*static_cast<long>(_nx) + s[0]);
+            }
+        }
         return cells;
     }
 
+    double CartesianGrid::minNeighborDistance() const
+    {
+        double dist = std::numeric_limits<double>::max();
+        for (const auto& s : _offsets)
+        {
+            dist = std::min(dist, std::sqrt(s[0]*s[0]*_dx*_dx + s[1]*s[1]*_dy*_dy + s[2]*s[2]*_dz*_dz));
+        }
+        return dist;
+    }
+
+    double CartesianGrid::maxNeighborDistance() const
+    {
+        double dist = 0.;
+        for (const auto& s : _offsets)
+        {
+            dist = std::max(dist, std::sqrt(s[0]*s[0]*_dx*_dx + s[1]*s[1]*_dy*_dy + s[2]*s[2]*_dz*_dz));
+        }
+        return dist;
+    }
+
     size_t CartesianGrid::nx() const
     {
         return _nx;
@@ -123,6 +168,38 @@ namespace mla
         return _resz;
     }
 
+    Stencil CartesianGrid::stencil() const
+    {
+        return _stencil;
+    }
+
+    void CartesianGrid::setStencil(const Stencil stencil)
+    {
+        _stencil = stencil;
+        _offsets.clear();
+        // Same ordering as the full 27-point loop, so ties are broken consistently
+        const int sz = (_nz == 1) ? 0 : 1;
+        for (int s0 = -1; s0 <= 1; s0++)
+            for (int s1 = -1; s1 <= 1; s1++)
+                for (int s2 = -sz; s2 <= sz; s2++)
+                {
+                    const int nonZero = (s0 != 0) + (s1 != 0) + (s2 != 0);
+                    if (nonZero == 0)
+                        continue;
+                    if (stencil == FACE && nonZero > 1)
+                        continue;
+                    if (stencil == EDGE && nonZero > 2)
+                        continue;
+                    std::array<int, 3> s = {{s0, s1, s2}};
+                    _offsets.push_back(s);
+                }
+    }
+
+    const std::vector<std::array<int, 3>>& CartesianGrid::offsets() const
+    {
+        return _offsets;
+    }
+
     size_t CartesianGrid::idCell(const Point3D p) const
     {
         int idx = static_cast<int>((p.get(0) - _p0.get(0)) / _dx);
@@ -146,6 +223,41 @@ namespace mla
         }
     }
 
+    std::vector<size_t> CartesianGrid::idCells(const std::vector<Point3D>& points) const
+    {
+        const size_t n = points.size();
+        const std::array<double, 3> d = {{_dx, _dy, _dz}};
+        const std::array<size_t, 3> sizes = {{_nx, _ny, _nz}};
+
+        // Position in cells along each axis, one axis at a time
+        std::vector<double> u(3 * n);
+        for (size_t a = 0; a < 3; a++)
+        {
+            double* ua = u.data() + a * n;
+            const double origin = _p0.get(a);
+            for (size_t i = 0; i < n; i++)
+                ua[i] = (points[i].p[a] - origin) / d[a];
+        }
+
+        std::vector<size_t> ids(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            std::array<int, 3> index;
+            bool isInDomain = true;
+            for (size_t a = 0; a < 3; a++)
+            {
+                index[a] = static_cast<int>(u[a * n + i]);
+                // Handle a point exactly on a boundary (as idCell)
+                if (points[i].p[a] - _p0.get(a) == d[a] * sizes[a])
+                    index[a]--;
+                isInDomain = isInDomain && index[a] >= 0 && static_cast<size_t>(index[a]) < sizes[a];
+            }
+            // The error of idCell for the first point outside the domain
+            ids[i] = isInDomain ? (index[2] * _ny + index[1]) * _nx + index[0] : idCell(points[i]);
+        }
+        return ids;
+    }
+
 
     bool CartesianGrid::isInside(const Point3D p) const
     {
@@ -183,6 +295,38 @@ namespace mla
         return _p0 + Point3D(idx*_dx, idy*_dy, idz*_dz) + Point3D(.5*_dx, .5*_dy, .5*_dz);
     }
 
+    // index[i] * d + origin + d / 2, in the order of the operations of centerOfCell
+    static void centersFromIndexes(std::vector<double>& index, const double origin, const double d)
+    {
+        const double half = .5 * d;
+        double* values = index.data();
+        for (size_t i = 0; i < index.size(); i++)
+            values[i] = (origin + values[i] * d) + half;
+    }
+
+    Coordinates CartesianGrid::centerOfCells(const std::vector<size_t>& ids) const
+    {
+        Coordinates centers;
+        centers.x.resize(ids.size());
+        centers.y.resize(ids.size());
+        centers.z.resize(ids.size());
+
+        // Integer split first, then the coordinates in loops without branches
+        const size_t nxy = _nx * _ny;
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            assert(ids[i] < numberOfCells());
+            const size_t rest = ids[i] % nxy;
+            centers.x[i] = static_cast<double>(rest % _nx);
+            centers.y[i] = static_cast<double>(rest / _nx);
+            centers.z[i] = static_cast<double>(ids[i] / nxy);
+        }
+        centersFromIndexes(centers.x, _p0.get(0), _dx);
+        centersFromIndexes(centers.y, _p0.get(1), _dy);
+        centersFromIndexes(centers.z, _p0.get(2), _dz);
+        return centers;
+    }
+
     size_t CartesianGrid::idNeighbor(const size_t id, const Direction dir) const
     {
         auto ids = splitId(id);
@@ -222,4 +366,21 @@ namespace mla
         return idz*_ny*_nx + idy*_nx + idx;
     }
 
+    Stencil stencilFromConnectivity(const size_t connectivity, const bool is2d)
+    {
+        if (connectivity == 0)
+            return FULL;
+        if (connectivity == (is2d ? 4 : 6))
+            return FACE;
+        if (!is2d && connectivity == 18)
+            return EDGE;
+        if (connectivity == (is2d ? 8 : 26))
+            return FULL;
+
+        std::stringstream s;
+        s << "ERROR: connectivity " << connectivity << " is not valid (use "
+          << (is2d ? "4 or 8" : "6, 18 or 26") << ")";
+        throw std::runtime_error(s.str());
+    }
+
 }
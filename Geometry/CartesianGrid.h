@@ -41,6 +41,13 @@ namespace mla
         ZM
     };
 
+    enum Stencil
+    {
+        FACE = 0, // FACE: cells sharing a face (6 in 3D, 4 in 2D)
+        EDGE,     // EDGE: cells sharing a face or an edge (18 in 3D, 8 in 2D)
+        FULL      // FULL: cells sharing a face, an edge or a corner (26 in 3D, 8 in 2D)
+    };
+
     class CartesianGrid : public Grid
     {
 
@@ -64,6 +71,10 @@ namespace mla
 
         virtual std::vector<size_t> neighbors(const size_t id) const;
 
+        virtual double minNeighborDistance() const;
+
+        virtual double maxNeighborDistance() const;
+
         // Functions
 
         size_t nx() const;
@@ -86,8 +97,18 @@ namespace mla
 
         size_t resz() const;
 
+        Stencil stencil() const;
+
+        void setStencil(const Stencil stencil);
+
+        // Offsets (in cells per direction) of the neighbors of the stencil
+        const std::vector<std::array<int, 3>>& offsets() const;
+
         size_t idCell(const Point3D p) const;
 
+        // Cells containing the points (throws as idCell if one of them is outside)
+        std::vector<size_t> idCells(const std::vector<Point3D>& points) const;
+
         bool isInside(const Point3D p) const;
 
         double volumeCell() const;
@@ -98,6 +119,9 @@ namespace mla
 
         Point3D centerOfCell(const size_t idx, const size_t idy, const size_t idz) const;
 
+        // Same values as centerOfCell, computed one axis at a time
+        virtual Coordinates centerOfCells(const std::vector<size_t>& ids) const;
+
         size_t idNeighbor(const size_t id, const Direction dir) const;
 
         std::array<size_t, 3> splitId(const size_t id) const;
@@ -111,8 +135,13 @@ namespace mla
         size_t _resx, _resy, _resz;
         Point3D _p0;
         bool _is2d;
+        Stencil _stencil;
+        std::vector<std::array<int, 3>> _offsets;
     };
 
+    // Stencil with the given number of neighbors (4 or 8 in 2D; 6, 18 or 26 in 3D; 0 for the full stencil)
+    Stencil stencilFromConnectivity(const size_t connectivity, const bool is2d);
+
 }
 
 
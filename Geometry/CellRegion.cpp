@@ -0,0 +1,173 @@
+/**
+* @file CellRegion.cpp
+* @brief Set of cells of a Cartesian grid given by geometric primitives
+*        (boxes, faces of the domain, points, segments) or by cell ids
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include "CellRegion.h"
+
+namespace mla
+{
+
+    CellRegion::CellRegion(const CartesianGrid* grid) : gridPtr(grid)
+    {
+    }
+
+    void CellRegion::addBox(const Point3D& lower, const Point3D& upper)
+    {
+        const std::array<size_t, 3> n = {{gridPtr->nx(), gridPtr->ny(), gridPtr->nz()}};
+        const std::array<double, 3> d = {{gridPtr->dx(), gridPtr->dy(), gridPtr->dz()}};
+        const Point3D first = gridPtr->centerOfCell(0, 0, 0);
+
+        std::array<size_t, 6> box;
+        for (size_t a = 0; a < 3; a++)
+        {
+            // Index range of the centers first + i*d inside [low, high]
+            const double low = std::min(lower.get(a), upper.get(a));
+            const double high = std::max(lower.get(a), upper.get(a));
+            const double iLow = std::ceil((low - first.get(a)) / d[a]);
+            const double iHigh = std::floor((high - first.get(a)) / d[a]) + 1.;
+            box[a] = static_cast<size_t>(std::min(std::max(iLow, 0.), static_cast<double>(n[a])));
+            box[a + 3] = static_cast<size_t>(std::min(std::max(iHigh, 0.), static_cast<double>(n[a])));
+            if (box[a + 3] <= box[a])
+                return;
+        }
+        boxes.push_back(box);
+    }
+
+    void CellRegion::addFace(const std::string& face)
+    {
+        std::array<size_t, 6> box = {{0, 0, 0, gridPtr->nx(), gridPtr->ny(), gridPtr->nz()}};
+        if (face.size() != 4 || face[0] < 'x' || face[0] > 'z' ||
+            (face.compare(1, 3, "min") != 0 && face.compare(1, 3, "max") != 0))
+        {
+            throw std::runtime_error("ERROR: unknown face '" + face + "' (use xmin, xmax, ymin, ymax, zmin or zmax)");
+        }
+        const size_t a = static_cast<size_t>(face[0] - 'x');
+        if (face.compare(1, 3, "min") == 0)
+            box[a + 3] = 1;
+        else
+            box[a] = box[a + 3] - 1;
+        boxes.push_back(box);
+    }
+
+    void CellRegion::addPoint(const Point3D& p)
+    {
+        explicitCells.push_back(gridPtr->idCell(p));
+    }
+
+    void CellRegion::addPoints(const std::vector<Point3D>& points)
+    {
+        const auto cells = gridPtr->idCells(points);
+        explicitCells.insert(explicitCells.end(), cells.begin(), cells.end());
+    }
+
+    void CellRegion::addSegment(const Point3D& a, const Point3D& b)
+    {
+        // Voxel traversal (Amanatides and Woo) in units of cells
+        const size_t first = gridPtr->idCell(a);
+        const size_t last = gridPtr->idCell(b);
+        const std::array<double, 3> d = {{gridPtr->dx(), gridPtr->dy(), gridPtr->dz()}};
+        const Point3D center = gridPtr->centerOfCell(0, 0, 0);
+
+        std::array<size_t, 3> cell = gridPtr->splitId(first);
+        const std::array<size_t, 3> end = gridPtr->splitId(last);
+        std::array<int, 3> step;
+        std::array<double, 3> tMax;
+        std::array<double, 3> tDelta;
+        for (size_t k = 0; k < 3; k++)
+        {
+            const double ua = (a.get(k) - center.get(k)) / d[k] + 0.5;
+            const double ub = (b.get(k) - center.get(k)) / d[k] + 0.5;
+            const double du = ub - ua;
+            step[k] = du > 0. ? 1 : (du < 0. ? -1 : 0);
+            if (step[k] == 0)
+            {
+                tMax[k] = std::numeric_limits<double>::max();
+                tDelta[k] = std::numeric_limits<double>::max();
+            }
+            else
+            {
+                const double boundary = step[k] > 0 ? cell[k] + 1. : static_cast<double>(cell[k]);
+                tMax[k] = (boundary - ua) / du;
+                tDelta[k] = std::abs(1. / du);
+            }
+        }
+
+        explicitCells.push_back(first);
+        while (cell != end)
+        {
+            size_t k = 0;
+            if (tMax[1] < tMax[k])
+                k = 1;
+            if (tMax[2] < tMax[k])
+                k = 2;
+            if (tMax[k] > 1.)
+                break;
+            if ((step[k] < 0 && cell[k] == 0) || (step[k] > 0 && cell[k] + 1 >= (k == 0 ? gridPtr->nx() : k == 1 ? gridPtr->ny() : gridPtr->nz())))
+                break;
+            cell[k] += step[k];
+            tMax[k] += tDelta[k];
+            explicitCells.push_back(gridPtr->mergeIds(cell[0], cell[1], cell[2]));
+        }
+        explicitCells.push_back(last);
+    }
+
+    void CellRegion::addCells(const std::vector<size_t>& cells)
+    {
+        for (auto cell : cells)
+        {
+            if (cell >= gridPtr->numberOfCells())
+            {
+                throw std::runtime_error("ERROR: cell " + std::to_string(cell) + " is outside the grid");
+            }
+        }
+        listedCells.insert(listedCells.end(), cells.begin(), cells.end());
+    }
+
+    std::vector<size_t> CellRegion::cells() const
+    {
+        std::vector<size_t> all;
+        forEach([&all](const size_t cell) { all.push_back(cell); });
+        return all;
+    }
+
+    bool CellRegion::empty() const
+    {
+        return boxes.empty() && listedCells.empty() && explicitCells.empty();
+    }
+
+    bool CellRegion::isInBoxes(const size_t i, const size_t j, const size_t k, const size_t nBoxes) const
+    {
+        for (size_t b = 0; b < nBoxes; b++)
+        {
+            const auto& box = boxes[b];
+            if (i >= box[0] && i < box[3] && j >= box[1] && j < box[4] && k >= box[2] && k < box[5])
+                return true;
+        }
+        return false;
+    }
+
+}
@@ -0,0 +1,116 @@
+/**
+* @file CellRegion.h
+* @brief Set of cells of a Cartesian grid given by geometric primitives
+*        (boxes, faces of the domain, points, segments) or by cell ids
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_CELLREGION_H
+#define LMA_CELLREGION_H
+
+#include <cstddef>
+#include <vector>
+#include <array>
+#include <string>
+#include <unordered_set>
+#include "CartesianGrid.h"
+
+namespace mla
+{
+
+    /**
+     * Boxes and faces are kept as ranges of cell indexes and expanded only when the cells
+     * are enumerated, so a whole face of a large grid costs a few words until then. Points
+     * and segments are resolved with CartesianGrid::idCell (idCells for lists of points).
+     * The listed cells (addCells) come first, in their order and with their repetitions, since
+     * the order of the targets breaks the ties between them; the other cells follow, each once.
+     */
+    class CellRegion
+    {
+
+    public:
+
+        CellRegion(const CartesianGrid* grid);
+
+        // Cells whose center is inside the box with the given opposite corners
+        void addBox(const Point3D& lower, const Point3D& upper);
+
+        // Cells of a face of the domain: xmin, xmax, ymin, ymax, zmin or zmax
+        void addFace(const std::string& face);
+
+        // Cell containing the point
+        void addPoint(const Point3D& p);
+
+        // Cells containing the points
+        void addPoints(const std::vector<Point3D>& points);
+
+        // Cells crossed by the segment (e.g. a well screen)
+        void addSegment(const Point3D& a, const Point3D& b);
+
+        void addCells(const std::vector<size_t>& cells);
+
+        // Call f(cell) for each cell of the region
+        template<typename F>
+        void forEach(F f) const
+        {
+            std::unordered_set<size_t> seen(listedCells.begin(), listedCells.end());
+            for (auto cell : listedCells)
+                f(cell);
+            for (size_t b = 0; b < boxes.size(); b++)
+            {
+                const auto& box = boxes[b];
+                for (size_t k = box[2]; k < box[5]; k++)
+                    for (size_t j = box[1]; j < box[4]; j++)
+                        for (size_t i = box[0]; i < box[3]; i++)
+                        {
+                            const size_t cell = gridPtr->mergeIds(i, j, k);
+                            if (!isInBoxes(i, j, k, b) && seen.count(cell) == 0)
+                                f(cell);
+                        }
+            }
+            for (auto cell : explicitCells)
+            {
+                const auto ids = gridPtr->splitId(cell);
+                if (!isInBoxes(ids[0], ids[1], ids[2], boxes.size()) && seen.insert(cell).second)
+                    f(cell);
+            }
+        };
+
+        // Expanded list of the cells
+        std::vector<size_t> cells() const;
+
+        bool empty() const;
+
+    private:
+
+        // True if (i, j, k) is in one of the first nBoxes boxes
+        bool isInBoxes(const size_t i, const size_t j, const size_t k, const size_t nBoxes) const;
+
+        const CartesianGrid* gridPtr;
+        std::vector<std::array<size_t, 6>> boxes;
+        std::vector<size_t> listedCells;
+        // Cells of the points and segments
+        std::vector<size_t> explicitCells;
+
+    };
+
+}
+
+#endif //LMA_CELLREGION_H
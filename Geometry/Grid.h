@@ -31,6 +31,13 @@
 
 namespace mla {
 
+    // Coordinates of many points, one array per axis
+    struct Coordinates {
+        std::vector<double> x;
+        std::vector<double> y;
+        std::vector<double> z;
+    };
+
     class Grid {
 
     protected:
@@ -52,6 +59,25 @@ namespace mla {
 
         virtual Point3D centerOfCell(const size_t id) const = 0;
 
+        // Centers of the cells ids[i] (one virtual call for all the cells)
+        virtual Coordinates centerOfCells(const std::vector<size_t>& ids) const {
+            Coordinates centers;
+            centers.x.resize(ids.size());
+            centers.y.resize(ids.size());
+            centers.z.resize(ids.size());
+            for (size_t i = 0; i < ids.size(); i++) {
+                const Point3D center = centerOfCell(ids[i]);
+                centers.x[i] = center.get(0);
+                centers.y[i] = center.get(1);
+                centers.z[i] = center.get(2);
+            }
+            return centers;
+        }
+
+        virtual double minNeighborDistance() const = 0;
+
+        virtual double maxNeighborDistance() const = 0;
+
         virtual size_t resx() const = 0;
 
         virtual size_t resy() const = 0;
@@ -29,9 +29,14 @@
 #include <cmath>
 #include <memory>
 #include <cassert>
+#include <type_traits>
+#include <ostream>
+#include <string>
 
 namespace mla {
 
+    // The points are trivially copyable (no virtual functions, implicit copies), so the compiler
+    // keeps the coordinates of the temporaries in registers
     template<typename T, std::size_t N>
     class Point {
 
@@ -42,11 +47,7 @@ namespace mla {
             p.fill(0.);
         };
 
-        Point(const std::array<T, N> &values) {
-            for (size_t i = 0; i < N; i++) {
-                p[i] = values[i];
-            }
-        };
+        Point(const std::array<T, N> &values) : p(values) {};
 
         Point(const Point<T, N - 1> &p2) {
             for (size_t i = 0; i < N - 1; i++) {
@@ -55,9 +56,6 @@ namespace mla {
             p[N - 1] = 0.;
         };
 
-        // Destructor
-        virtual ~Point() {};
-
         // Generic Functions
         T distanceFrom(const Point<T, N> &p2) const {
             T sum = 0.;
@@ -77,13 +75,6 @@ namespace mla {
         }
 
         // Operators
-        Point<T, N> &operator=(Point<T, N> const &p2) {
-            for (size_t i = 0; i < N; i++) {
-                p[i] = p2.p[i];
-            }
-            return (Point<T, N>&)*this;
-        };
-
         Point<T, N> operator+(Point<T, N> const &p2) const {
             std::array<T, N> t{};
             for (size_t i = 0; i < N; i++) {
@@ -138,7 +129,7 @@ namespace mla {
         };
 
         bool operator!=(const Point<T, N> &p2) const {
-            return !((Point<T, N>&)*this == p2);
+            return !(*this == p2);
         };
 
         // Output
@@ -166,10 +157,7 @@ namespace mla {
 
         Point2D(const double x1, const double x2) : mla::Point<double, 2>(std::array<double, 2>{{x1, x2}}) {};
 
-        Point2D(const Point<double, 2>& p1) {
-            p[0] = p1.p[0];
-            p[1] = p1.p[1];
-        }
+        Point2D(const Point<double, 2>& p1) : mla::Point<double, 2>(p1) {};
 
     };
 
@@ -184,16 +172,13 @@ namespace mla {
 
         Point3D(const Point2D &p2) : mla::Point<double, 3>(p2) {};
 
-        Point3D(const Point<double, 3> &p1) {
-            p[0] = p1.get(0);
-            p[1] = p1.get(1);
-            p[2] = p1.get(2);
-        }
-
-
+        Point3D(const Point<double, 3> &p1) : mla::Point<double, 3>(p1) {};
 
     };
 
+    static_assert(std::is_trivially_copyable<Point2D>::value && std::is_trivially_copyable<Point3D>::value,
+                  "the points must stay trivially copyable");
+
 }
 
 #endif //LMA_POINT_H
@@ -28,6 +28,7 @@
 #include <cstddef>
 #include <Point.h>
 #include <assert.h>
+#include <type_traits>
 
 namespace mla {
 
@@ -49,9 +50,6 @@ namespace mla {
 
         Vector(const Vector<T, N - 1> &v) : p1(v.getStartPoint()), p2(v.getEndPoint()) {};
 
-        // Destructor
-        ~Vector() {};
-
         // Generic Functions
         T get(size_t i) const {
             return p2.get(i) - p1.get(i);
@@ -115,12 +113,6 @@ namespace mla {
         };
 
         // Operators
-        Vector<T, N> &operator=(Vector<T, N> const &v2) {
-            p1 = v2.p1;
-            p2 = v2.p2;
-            return (Vector<T, N> &)*this;
-        };
-
         Vector<T, N> operator+(Vector<T, N> const &v2) const {
             return Vector<T, N>(this->p1, v2.p2 - v2.p1 + this->p2);
         };
@@ -166,7 +158,7 @@ namespace mla {
 
         Vector3D(const mla::Vector<double, 2> &v) :  mla::Vector<double, 3>(v) {}
 
-        Vector3D(const mla::Vector<double, 3> &v) :  mla::Vector<double, 3>(v.getStartPoint(), v.getEndPoint()) {};
+        Vector3D(const mla::Vector<double, 3> &v) :  mla::Vector<double, 3>(v) {};
 
         Vector3D(const Point3D &startPoint, const Point3D &endPoint) : mla::Vector<double, 3>(startPoint, endPoint) {};
 
@@ -179,7 +171,7 @@ namespace mla {
     public:
         Vector2D() : mla::Vector<double, 2>() {};
 
-        Vector2D(const mla::Vector<double, 2> &v) : mla::Vector<double, 2>(v.getStartPoint(), v.getEndPoint()) {};
+        Vector2D(const mla::Vector<double, 2> &v) : mla::Vector<double, 2>(v) {};
 
         Vector2D(const Point2D &startPoint, const Point2D &endPoint) : mla::Vector<double, 2>(startPoint, endPoint) {};
 
@@ -197,6 +189,9 @@ namespace mla {
 
     };
 
+    static_assert(std::is_trivially_copyable<Vector2D>::value && std::is_trivially_copyable<Vector3D>::value,
+                  "the vectors must stay trivially copyable");
+
 }
 
 #endif //LMA_VECTOR_H
@@ -72,6 +72,14 @@ namespace lma
         return config["grid"]["refinement"]["refz"].as<size_t>();
     }
 
+    size_t Input::connectivity() const
+    {
+        if (config["grid"]["connectivity"])
+            return config["grid"]["connectivity"].as<size_t>();
+        // Full stencil of the grid: 8 neighbors in 2D, 26 in 3D
+        return 0;
+    }
+
     // INPUT PARAMETERS
     std::string Input::field() const
     {
@@ -85,6 +93,35 @@ namespace lma
     {
         return config["input"]["field"]["log"].as<bool>();
     }
+    bool Input::fieldLazy() const
+    {
+        if (config["input"]["field"]["lazy"])
+            return config["input"]["field"]["lazy"].as<bool>();
+        return false;
+    }
+
+    bool Input::hasMaskFile() const
+    {
+        return config["input"]["mask"] && config["input"]["mask"]["file"];
+    }
+    std::string Input::maskFile() const
+    {
+        return config["input"]["mask"]["file"].as<std::string>();
+    }
+    size_t Input::maskSkip() const
+    {
+        if (config["input"]["mask"]["skip"])
+            return config["input"]["mask"]["skip"].as<size_t>();
+        return 0;
+    }
+    bool Input::hasMaskThreshold() const
+    {
+        return config["input"]["mask"] && config["input"]["mask"]["threshold"];
+    }
+    double Input::maskThreshold() const
+    {
+        return config["input"]["mask"]["threshold"].as<double>();
+    }
 
     std::string Input::source() const
     {
@@ -95,15 +132,325 @@ namespace lma
         return config["input"]["target"]["file"].as<std::string>();
     }
 
+    // A single list of numbers or a list of lists
+    static std::vector<std::vector<double>> listOfLists(const YAML::Node& node)
+    {
+        std::vector<std::vector<double>> lists;
+        if (!node)
+            return lists;
+        if (node.size() > 0 && node[0].IsScalar())
+        {
+            lists.push_back(node.as<std::vector<double>>());
+            return lists;
+        }
+        for (const auto& item : node)
+            lists.push_back(item.as<std::vector<double>>());
+        return lists;
+    }
+
+    bool Input::hasRegionFile(const std::string& name) const
+    {
+        return config["input"][name] && config["input"][name]["file"];
+    }
+    std::vector<std::vector<double>> Input::regionBoxes(const std::string& name) const
+    {
+        if (!config["input"][name])
+            return std::vector<std::vector<double>>();
+        return listOfLists(config["input"][name]["box"]);
+    }
+    std::vector<std::string> Input::regionFaces(const std::string& name) const
+    {
+        if (!config["input"][name] || !config["input"][name]["face"])
+            return std::vector<std::string>();
+        const YAML::Node node = config["input"][name]["face"];
+        if (node.IsScalar())
+            return std::vector<std::string>(1, node.as<std::string>());
+        return node.as<std::vector<std::string>>();
+    }
+    std::vector<std::vector<double>> Input::regionPoints(const std::string& name) const
+    {
+        if (!config["input"][name])
+            return std::vector<std::vector<double>>();
+        return listOfLists(config["input"][name]["points"]);
+    }
+    std::vector<std::vector<double>> Input::regionSegments(const std::string& name) const
+    {
+        if (!config["input"][name])
+            return std::vector<std::vector<double>>();
+        return listOfLists(config["input"][name]["segment"]);
+    }
+
+    // SOLVER PARAMETERS
+    bool Input::stopAtTargets() const
+    {
+        if (config["solver"] && config["solver"]["stop"] && config["solver"]["stop"]["targets"])
+            return config["solver"]["stop"]["targets"].as<bool>();
+        return false;
+    }
+    double Input::maxResistance() const
+    {
+        if (config["solver"] && config["solver"]["stop"] && config["solver"]["stop"]["max resistance"])
+            return config["solver"]["stop"]["max resistance"].as<double>();
+        return std::numeric_limits<double>::max();
+    }
+
+    size_t Input::threads() const
+    {
+        if (config["solver"] && config["solver"]["threads"])
+            return config["solver"]["threads"].as<size_t>();
+        return 0;
+    }
+    std::string Input::queue() const
+    {
+        if (config["solver"] && config["solver"]["queue"])
+            return config["solver"]["queue"].as<std::string>();
+        return "heap";
+    }
+    double Input::epsilon() const
+    {
+        if (config["solver"] && config["solver"]["epsilon"])
+            return config["solver"]["epsilon"].as<double>();
+        return 0.01;
+    }
+
+    bool Input::hasMultilevel() const
+    {
+        return config["solver"] && config["solver"]["multilevel"];
+    }
+    size_t Input::multilevelFactor() const
+    {
+        if (config["solver"]["multilevel"]["factor"])
+            return config["solver"]["multilevel"]["factor"].as<size_t>();
+        return 4;
+    }
+    std::string Input::multilevelAveraging() const
+    {
+        if (config["solver"]["multilevel"]["averaging"])
+            return config["solver"]["multilevel"]["averaging"].as<std::string>();
+        return "geometric";
+    }
+    size_t Input::multilevelCorridor() const
+    {
+        if (config["solver"]["multilevel"]["corridor"])
+            return config["solver"]["multilevel"]["corridor"].as<size_t>();
+        return 1;
+    }
+    bool Input::multilevelVerify() const
+    {
+        if (config["solver"]["multilevel"]["verify"])
+            return config["solver"]["multilevel"]["verify"].as<bool>();
+        return true;
+    }
+    bool Input::hasFlowCorridor() const
+    {
+        return config["solver"] && config["solver"]["corridor"];
+    }
+    double Input::flowCorridorTolerance() const
+    {
+        if (config["solver"]["corridor"]["tolerance"])
+            return config["solver"]["corridor"]["tolerance"].as<double>();
+        return 0.05;
+    }
+    bool Input::hasCheckpoint() const
+    {
+        return config["solver"] && config["solver"]["checkpoint"];
+    }
+    std::string Input::checkpointFile() const
+    {
+        return config["solver"]["checkpoint"]["file"].as<std::string>();
+    }
+    size_t Input::checkpointCells() const
+    {
+        if (config["solver"]["checkpoint"]["cells"])
+            return config["solver"]["checkpoint"]["cells"].as<size_t>();
+        return 0;
+    }
+    double Input::checkpointSeconds() const
+    {
+        if (config["solver"]["checkpoint"]["seconds"])
+            return config["solver"]["checkpoint"]["seconds"].as<double>();
+        return 600.;
+    }
+    bool Input::checkpointResume() const
+    {
+        if (config["solver"] && config["solver"]["checkpoint"] && config["solver"]["checkpoint"]["resume"])
+            return config["solver"]["checkpoint"]["resume"].as<bool>();
+        return true;
+    }
+    bool Input::hasCache() const
+    {
+        return config["solver"] && config["solver"]["cache"];
+    }
+    std::string Input::cacheFile() const
+    {
+        return config["solver"]["cache"].as<std::string>();
+    }
+
+    // ENSEMBLE PARAMETERS
+    bool Input::hasEnsemble() const
+    {
+        return static_cast<bool>(config["ensemble"]);
+    }
+    size_t Input::ensembleFirst() const
+    {
+        if (config["ensemble"]["first"])
+            return config["ensemble"]["first"].as<size_t>();
+        return 0;
+    }
+    size_t Input::ensembleRealizations() const
+    {
+        return config["ensemble"]["realizations"].as<size_t>();
+    }
+    std::string Input::ensembleField() const
+    {
+        return config["ensemble"]["field"].as<std::string>();
+    }
+    std::string Input::ensembleResistance() const
+    {
+        if (config["ensemble"]["resistance"])
+            return config["ensemble"]["resistance"].as<std::string>();
+        return "";
+    }
+    std::string Input::ensemblePath() const
+    {
+        if (config["ensemble"]["path"])
+            return config["ensemble"]["path"].as<std::string>();
+        return "";
+    }
+    std::string Input::ensembleSummary() const
+    {
+        if (config["ensemble"]["summary"])
+            return config["ensemble"]["summary"].as<std::string>();
+        return "ensemble.dat";
+    }
+    size_t Input::ensembleWorkers() const
+    {
+        if (config["ensemble"]["workers"])
+            return config["ensemble"]["workers"].as<size_t>();
+        return 0;
+    }
+    size_t Input::ensembleQueue() const
+    {
+        if (config["ensemble"]["queue"])
+            return config["ensemble"]["queue"].as<size_t>();
+        return 0;
+    }
+
+    // CONNECTIVITY PARAMETERS
+    bool Input::hasConnectivity() const
+    {
+        return static_cast<bool>(config["connectivity"]);
+    }
+    size_t Input::connectivityRadius() const
+    {
+        return config["connectivity"]["radius"].as<size_t>();
+    }
+    std::string Input::connectivityFile() const
+    {
+        if (config["connectivity"]["file"])
+            return config["connectivity"]["file"].as<std::string>();
+        return "connectivity.dat";
+    }
+
+    // MEMORY PARAMETERS
+    std::string Input::memoryPages() const
+    {
+        if (config["memory"] && config["memory"]["pages"])
+            return config["memory"]["pages"].as<std::string>();
+        return "small";
+    }
+    std::string Input::memoryPlacement() const
+    {
+        if (config["memory"] && config["memory"]["placement"])
+            return config["memory"]["placement"].as<std::string>();
+        return "default";
+    }
+    size_t Input::memoryThreads() const
+    {
+        if (config["memory"] && config["memory"]["threads"])
+            return config["memory"]["threads"].as<size_t>();
+        return 1;
+    }
+
     // OUTPUT PARAMETERS
     std::string Input::outputRes() const
     {
         return config["output"]["resistance"]["file"].as<std::string>();
     }
+    std::string Input::outputResFormat() const
+    {
+        if (config["output"]["resistance"]["format"])
+            return config["output"]["resistance"]["format"].as<std::string>();
+        return "dense";
+    }
     std::string Input::outputPath() const
     {
         return config["output"]["path"]["file"].as<std::string>();
     }
+    bool Input::hasOutputPaths() const
+    {
+        return static_cast<bool>(config["output"]["paths"]);
+    }
+    std::string Input::outputPaths() const
+    {
+        return config["output"]["paths"]["file"].as<std::string>();
+    }
+    bool Input::hasOutputLabels() const
+    {
+        return config["output"]["labels"] && config["output"]["labels"]["file"];
+    }
+    std::string Input::outputLabels() const
+    {
+        return config["output"]["labels"]["file"].as<std::string>();
+    }
+    bool Input::hasOutputLabelTargets() const
+    {
+        return config["output"]["labels"] && config["output"]["labels"]["targets"];
+    }
+    std::string Input::outputLabelTargets() const
+    {
+        return config["output"]["labels"]["targets"].as<std::string>();
+    }
+    std::string Input::outputCorridorMask() const
+    {
+        if (config["output"]["corridor"] && config["output"]["corridor"]["mask"])
+            return config["output"]["corridor"]["mask"].as<std::string>();
+        return "corridor.dat";
+    }
+    std::string Input::outputCorridorSlack() const
+    {
+        if (config["output"]["corridor"] && config["output"]["corridor"]["slack"])
+            return config["output"]["corridor"]["slack"].as<std::string>();
+        return "slack.dat";
+    }
+    bool Input::hasOutputSensitivity() const
+    {
+        return config["output"]["sensitivity"] && config["output"]["sensitivity"]["file"];
+    }
+    std::string Input::outputSensitivity() const
+    {
+        return config["output"]["sensitivity"]["file"].as<std::string>();
+    }
+    std::string Input::outputSensitivityTargets() const
+    {
+        if (config["output"]["sensitivity"]["targets"])
+            return config["output"]["sensitivity"]["targets"].as<std::string>();
+        return "best";
+    }
+    bool Input::outputSensitivityLog() const
+    {
+        if (config["output"]["sensitivity"]["log"])
+            return config["output"]["sensitivity"]["log"].as<bool>();
+        return false;
+    }
+    bool Input::hasOutputAttribute(const std::string& name) const
+    {
+        return config["output"]["attributes"] && config["output"]["attributes"][name];
+    }
+    std::string Input::outputAttribute(const std::string& name) const
+    {
+        return config["output"]["attributes"][name].as<std::string>();
+    }
 
 
 }
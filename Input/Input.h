@@ -28,6 +28,8 @@
 #include <sstream>
 #include <string>
 #include <iostream>
+#include <limits>
+#include <vector>
 
 namespace lma
 {
@@ -49,15 +51,86 @@ namespace lma
         size_t refy() const;
         size_t refz() const;
 
+        // Number of neighbors, 0 if not given (full stencil)
+        size_t connectivity() const;
 
         std::string field() const;
         size_t fieldSkip() const;
         bool fieldLog() const;
+        bool fieldLazy() const;
 
+        bool hasMaskFile() const;
+        std::string maskFile() const;
+        size_t maskSkip() const;
+        bool hasMaskThreshold() const;
+        double maskThreshold() const;
+
+        // Sources and targets (name = "source" or "target"): list of ids in a file and/or
+        // geometric regions (boxes, faces, points and segments, see CellRegion)
+        bool hasRegionFile(const std::string& name) const;
+        std::vector<std::vector<double>> regionBoxes(const std::string& name) const;
+        std::vector<std::string> regionFaces(const std::string& name) const;
+        std::vector<std::vector<double>> regionPoints(const std::string& name) const;
+        std::vector<std::vector<double>> regionSegments(const std::string& name) const;
         std::string source() const;
         std::string target() const;
+
+        bool stopAtTargets() const;
+        double maxResistance() const;
+        size_t threads() const;
+        std::string queue() const;
+        double epsilon() const;
+        bool hasMultilevel() const;
+        size_t multilevelFactor() const;
+        std::string multilevelAveraging() const;
+        size_t multilevelCorridor() const;
+        bool multilevelVerify() const;
+        bool hasFlowCorridor() const;
+        double flowCorridorTolerance() const;
+        bool hasCheckpoint() const;
+        std::string checkpointFile() const;
+        size_t checkpointCells() const;
+        double checkpointSeconds() const;
+        bool checkpointResume() const;
+        bool hasCache() const;
+        std::string cacheFile() const;
+
+        bool hasEnsemble() const;
+        size_t ensembleFirst() const;
+        size_t ensembleRealizations() const;
+        std::string ensembleField() const;
+        std::string ensembleResistance() const;
+        std::string ensemblePath() const;
+        std::string ensembleSummary() const;
+        size_t ensembleWorkers() const;
+        size_t ensembleQueue() const;
+
+        bool hasConnectivity() const;
+        size_t connectivityRadius() const;
+        std::string connectivityFile() const;
+
+        std::string memoryPages() const;
+        std::string memoryPlacement() const;
+        size_t memoryThreads() const;
+
         std::string outputRes() const;
+        std::string outputResFormat() const;
         std::string outputPath() const;
+        bool hasOutputPaths() const;
+        std::string outputPaths() const;
+        bool hasOutputLabels() const;
+        std::string outputLabels() const;
+        bool hasOutputLabelTargets() const;
+        std::string outputLabelTargets() const;
+        std::string outputCorridorMask() const;
+        std::string outputCorridorSlack() const;
+        bool hasOutputSensitivity() const;
+        std::string outputSensitivity() const;
+        std::string outputSensitivityTargets() const;
+        bool outputSensitivityLog() const;
+        // Path attributes: length, steps, minK or maxK
+        bool hasOutputAttribute(const std::string& name) const;
+        std::string outputAttribute(const std::string& name) const;
 
     private:
 
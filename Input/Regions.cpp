@@ -0,0 +1,112 @@
+/**
+* @file Regions.cpp
+* @brief Sources and targets of the configuration: cell ids in a file and/or
+*        geometric regions (boxes, faces, points, segments)
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Regions.h"
+#include "Streams.h"
+#include <limits>
+#include <stdexcept>
+#include <CellRegion.h>
+
+namespace lma {
+
+    std::vector<size_t> loadIds(const std::string& fileName)
+    {
+        InputStream inStream(fileName);
+
+        std::vector<size_t> ids;
+        size_t id;
+        while (inStream.get() >> id)
+        {
+            ids.push_back(id);
+        }
+
+        return ids;
+    }
+
+    // Point of the configuration, z can be omitted on 2D grids (nz = 1)
+    static mla::Point3D regionPoint(const std::vector<double>& values, const size_t first, const bool hasZ,
+                                    const mla::CartesianGrid* grid)
+    {
+        const double z = hasZ ? values[first + 2] : grid->centerOfCell(0, 0, 0).get(2);
+        return mla::Point3D({{values[first], values[first + 1], z}});
+    }
+
+    std::vector<size_t> loadRegion(const Input& config, const std::string& name, const std::string& configPath,
+                                   const mla::CartesianGrid* grid)
+    {
+        mla::CellRegion region(grid);
+        if (config.hasRegionFile(name))
+        {
+            region.addCells(loadIds(resolvePath(configPath, name == "source" ? config.source() : config.target())));
+        }
+
+        const bool is2d = grid->nz() == 1;
+        const double INF = std::numeric_limits<double>::max();
+        for (const auto& box : config.regionBoxes(name))
+        {
+            if (box.size() == 6)
+            {
+                region.addBox(regionPoint(box, 0, true, grid), regionPoint(box, 3, true, grid));
+            }
+            else if (box.size() == 4 && is2d)
+            {
+                region.addBox(mla::Point3D({{box[0], box[1], -INF}}), mla::Point3D({{box[2], box[3], INF}}));
+            }
+            else
+            {
+                throw std::runtime_error("ERROR: a " + name + " box needs 6 coordinates (x0, y0, z0, x1, y1, z1)");
+            }
+        }
+        for (const auto& face : config.regionFaces(name))
+        {
+            region.addFace(face);
+        }
+        std::vector<mla::Point3D> points;
+        for (const auto& point : config.regionPoints(name))
+        {
+            if (point.size() != 3 && !(point.size() == 2 && is2d))
+            {
+                throw std::runtime_error("ERROR: a " + name + " point needs 3 coordinates (x, y, z)");
+            }
+            points.push_back(regionPoint(point, 0, point.size() == 3, grid));
+        }
+        region.addPoints(points);
+        for (const auto& segment : config.regionSegments(name))
+        {
+            if (segment.size() != 6 && !(segment.size() == 4 && is2d))
+            {
+                throw std::runtime_error("ERROR: a " + name + " segment needs 6 coordinates (x0, y0, z0, x1, y1, z1)");
+            }
+            const bool hasZ = segment.size() == 6;
+            region.addSegment(regionPoint(segment, 0, hasZ, grid), regionPoint(segment, hasZ ? 3 : 2, hasZ, grid));
+        }
+
+        if (region.empty())
+        {
+            throw std::runtime_error("ERROR: no " + name + " cells (use file, box, face, points or segment)");
+        }
+        return region.cells();
+    }
+
+}
@@ -0,0 +1,45 @@
+/**
+* @file Regions.h
+* @brief Sources and targets of the configuration: cell ids in a file and/or
+*        geometric regions (boxes, faces, points, segments)
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_REGIONS_H
+#define LMA_REGIONS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <CartesianGrid.h>
+#include "Input.h"
+
+namespace lma {
+
+    // Cell ids, one per line (or separated by spaces)
+    std::vector<size_t> loadIds(const std::string& fileName);
+
+    // Sources or targets (name = "source" or "target"): ids in a file and/or geometric regions
+    std::vector<size_t> loadRegion(const Input& config, const std::string& name, const std::string& configPath,
+                                   const mla::CartesianGrid* grid);
+
+}
+
+#endif //LMA_REGIONS_H
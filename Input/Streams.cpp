@@ -0,0 +1,177 @@
+/**
+* @file Streams.cpp
+* @brief Inputs and outputs named in the configuration: files, standard
+*        input/output ("-") and POSIX shared memory segments ("shm:/name")
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Streams.h"
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace lma {
+
+    static const std::string SHM_PREFIX = "shm:";
+
+    bool isStandardStream(const std::string& name)
+    {
+        return name == "-";
+    }
+
+    bool isSharedMemory(const std::string& name)
+    {
+        return name.compare(0, SHM_PREFIX.size(), SHM_PREFIX) == 0;
+    }
+
+    std::string resolvePath(const std::string& folder, const std::string& name)
+    {
+        if (isStandardStream(name) || isSharedMemory(name) || name.empty())
+            return name;
+        if (name[0] == '/' || name[0] == '\\' || (name.size() > 1 && name[1] == ':'))
+            return name;
+        return folder + name;
+    }
+
+    InputStream::InputStream(const std::string& name, std::istream& standardInput) : stream(&standardInput)
+    {
+        if (isStandardStream(name))
+            return;
+        if (isSharedMemory(name))
+        {
+            throw std::runtime_error("ERROR: only the binary conductivity can be read from shared memory (" + name + ")");
+        }
+        file.open(name, std::ifstream::in);
+        if (!file)
+        {
+            throw std::runtime_error("ERROR: cannot find the file " + name);
+        }
+        stream = &file;
+    }
+
+    std::istream& InputStream::get()
+    {
+        return *stream;
+    }
+
+    OutputStream::OutputStream(const std::string& name, std::ostream& standardOutput) :
+            name(name), stream(&standardOutput)
+    {
+        if (isStandardStream(name))
+            return;
+        if (isSharedMemory(name))
+        {
+            throw std::runtime_error("ERROR: only the resistance map can be written to shared memory (" + name + ")");
+        }
+        file.open(name);
+        if (!file)
+        {
+            throw std::runtime_error("ERROR: cannot open the file " + name);
+        }
+        stream = &file;
+    }
+
+    std::ostream& OutputStream::get()
+    {
+        return *stream;
+    }
+
+    void OutputStream::close()
+    {
+        stream->flush();
+        if (!*stream)
+        {
+            throw std::runtime_error("ERROR: cannot write " + (isStandardStream(name) ? std::string("the standard output") : name));
+        }
+        if (file.is_open())
+            file.close();
+    }
+
+    SharedMemory::SharedMemory(const std::string& name) : address(nullptr), length(0)
+    {
+        map(name, false, 0);
+    }
+
+    SharedMemory::SharedMemory(const std::string& name, const size_t size) : address(nullptr), length(0)
+    {
+        map(name, true, size);
+    }
+
+#ifndef _WIN32
+    void SharedMemory::map(const std::string& name, const bool isWritable, const size_t size)
+    {
+        const std::string segment = isSharedMemory(name) ? name.substr(SHM_PREFIX.size()) : name;
+        const int fd = isWritable ? shm_open(segment.c_str(), O_RDWR | O_CREAT, 0600)
+                                  : shm_open(segment.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+        {
+            throw std::runtime_error("ERROR: cannot open the shared memory segment " + segment);
+        }
+        if (isWritable)
+        {
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                close(fd);
+                throw std::runtime_error("ERROR: cannot resize the shared memory segment " + segment);
+            }
+            length = size;
+        }
+        else
+        {
+            struct stat info;
+            if (fstat(fd, &info) != 0)
+            {
+                close(fd);
+                throw std::runtime_error("ERROR: cannot read the size of the shared memory segment " + segment);
+            }
+            length = static_cast<size_t>(info.st_size);
+        }
+        if (length > 0)
+        {
+            void* data = mmap(nullptr, length, isWritable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                close(fd);
+                throw std::runtime_error("ERROR: cannot map the shared memory segment " + segment);
+            }
+            address = static_cast<char*>(data);
+        }
+        close(fd);
+    }
+
+    SharedMemory::~SharedMemory()
+    {
+        if (address != nullptr)
+            munmap(address, length);
+    }
+#else
+    void SharedMemory::map(const std::string& name, const bool, const size_t)
+    {
+        throw std::runtime_error("ERROR: shared memory segments are not supported on this platform (" + name + ")");
+    }
+
+    SharedMemory::~SharedMemory() {}
+#endif
+}
@@ -0,0 +1,120 @@
+/**
+* @file Streams.h
+* @brief Inputs and outputs named in the configuration: files, standard
+*        input/output ("-") and POSIX shared memory segments ("shm:/name")
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_STREAMS_H
+#define LMA_STREAMS_H
+
+#include <cstddef>
+#include <string>
+#include <fstream>
+#include <iostream>
+
+namespace lma {
+
+    // "-" is the standard input or output
+    bool isStandardStream(const std::string& name);
+
+    // "shm:/name" is a POSIX shared memory segment
+    bool isSharedMemory(const std::string& name);
+
+    // Names of the configuration: "-", "shm:" and absolute paths are kept, other paths are
+    // relative to the folder of the configuration. Named pipes (FIFOs) are opened as files.
+    std::string resolvePath(const std::string& folder, const std::string& name);
+
+    class InputStream {
+
+    public:
+
+        InputStream(const std::string& name, std::istream& standardInput = std::cin);
+
+        std::istream& get();
+
+    private:
+
+        std::ifstream file;
+        std::istream* stream;
+
+    };
+
+    class OutputStream {
+
+    public:
+
+        OutputStream(const std::string& name, std::ostream& standardOutput = std::cout);
+
+        std::ostream& get();
+
+        // Flush the output, throws if something could not be written
+        void close();
+
+    private:
+
+        std::string name;
+        std::ofstream file;
+        std::ostream* stream;
+
+    };
+
+    /**
+     * Memory mapped POSIX shared memory segment. The segment is left in place when the
+     * mapping is released, so that another process can read it (and unlink it).
+     */
+    class SharedMemory {
+
+    public:
+
+        // Map an existing segment, read only
+        explicit SharedMemory(const std::string& name);
+
+        // Create (or resize) a segment of the given size, read and write
+        SharedMemory(const std::string& name, const size_t size);
+
+        SharedMemory(const SharedMemory&) = delete;
+        SharedMemory& operator=(const SharedMemory&) = delete;
+
+        ~SharedMemory();
+
+        const char* data() const {
+            return address;
+        };
+
+        char* data() {
+            return address;
+        };
+
+        size_t size() const {
+            return length;
+        };
+
+    private:
+
+        void map(const std::string& name, const bool isWritable, const size_t size);
+
+        char* address;
+        size_t length;
+
+    };
+}
+
+#endif //LMA_STREAMS_H
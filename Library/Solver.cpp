@@ -0,0 +1,171 @@
+/**
+* @file Solver.cpp
+* @brief C++ interface of the lazymole library (in-memory inputs and outputs)
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdexcept>
+#include <vector>
+#include <cmath>
+#include <CartesianGrid.h>
+#include <CellField.h>
+#include <LazyMole.h>
+#include "Solver.h"
+
+namespace lma
+{
+    Solver::Solver(const GridSpec& spec, const double* conductivity, const Options& options)
+            : options(options), progressPops(65536), cancelToken(nullptr)
+    {
+        if (spec.nx == 0 || spec.ny == 0 || spec.nz == 0)
+        {
+            throw std::invalid_argument("ERROR: the grid must have at least one cell per direction");
+        }
+        if (conductivity == nullptr)
+        {
+            throw std::invalid_argument("ERROR: the conductivity is missing");
+        }
+
+        grid.reset(new mla::CartesianGrid(spec.nx, spec.ny, spec.nz, spec.dx, spec.dy, spec.dz));
+        setOptions(options);
+
+        field.reset(new mla::CellField<double>(grid.get(), 0.));
+        for (size_t id = 0; id < grid->numberOfCells(); id++)
+        {
+            const double k = options.log ? std::exp(conductivity[id]) : conductivity[id];
+            if (!(k > 0.))
+            {
+                throw std::invalid_argument("ERROR: the conductivity must be positive");
+            }
+            field->set(id, k);
+        }
+    }
+
+    Solver::~Solver() {}
+
+    size_t Solver::numberOfCells() const
+    {
+        return grid->numberOfCells();
+    }
+
+    const Options& Solver::getOptions() const
+    {
+        return options;
+    }
+
+    void Solver::setOptions(const Options& newOptions)
+    {
+        grid->setStencil(newOptions.connectivity == 0 ? mla::FULL :
+                         mla::stencilFromConnectivity(newOptions.connectivity, grid->nz() == 1));
+        options = newOptions;
+    }
+
+    void Solver::setProgress(const std::function<void(const Progress&)>& callback, const size_t nPops)
+    {
+        progress = callback;
+        progressPops = nPops;
+    }
+
+    void Solver::setCancellation(const std::atomic<bool>* token)
+    {
+        cancelToken = token;
+    }
+
+    Result Solver::solve(const size_t* sources, const size_t nSources,
+                         const size_t* targets, const size_t nTargets,
+                         double* resistance, size_t* path, const size_t pathCapacity) const
+    {
+        const size_t nCells = grid->numberOfCells();
+        std::vector<size_t> ids(sources, sources + nSources);
+        std::vector<size_t> idsTarget(targets, targets + nTargets);
+        for (auto id : ids)
+        {
+            if (id >= nCells)
+                throw std::out_of_range("ERROR: source id outside the grid");
+        }
+        for (auto id : idsTarget)
+        {
+            if (id >= nCells)
+                throw std::out_of_range("ERROR: target id outside the grid");
+        }
+
+        mla::LazyMole lazyMole(grid.get(), *field, ids);
+        if (options.stopAtTargets)
+        {
+            lazyMole.setTargets(idsTarget);
+        }
+        lazyMole.setMaxResistance(options.maxResistance);
+        lazyMole.setApproximation(options.epsilon);
+        if (progress)
+        {
+            const auto callback = progress;
+            lazyMole.setProgress([callback](const mla::RunProgress& state)
+            {
+                Progress converted;
+                converted.settled = state.settled;
+                converted.total = state.total;
+                converted.resistance = state.resistance;
+                converted.elapsed = state.elapsed;
+                converted.eta = state.eta;
+                callback(converted);
+            }, progressPops);
+        }
+        lazyMole.setCancellation(cancelToken);
+        auto smallestRes = lazyMole.run();
+
+        Result result;
+        result.mhr = std::numeric_limits<double>::max();
+        result.target = nCells;
+        result.pathLength = 0;
+        result.errorBound = lazyMole.errorBound();
+        result.cancelled = lazyMole.cancelled();
+        for (auto id : idsTarget)
+        {
+            if (smallestRes->getFromCell(id) < result.mhr)
+            {
+                result.mhr = smallestRes->getFromCell(id);
+                result.target = id;
+            }
+        }
+
+        if (resistance != nullptr)
+        {
+            for (size_t id = 0; id < nCells; id++)
+            {
+                resistance[id] = smallestRes->getFromCell(id);
+            }
+        }
+
+        if (result.target != nCells)
+        {
+            auto cells = lazyMole.pathCells(result.target);
+            result.pathLength = cells.size();
+            if (path != nullptr)
+            {
+                for (size_t i = 0; i < cells.size() && i < pathCapacity; i++)
+                {
+                    path[i] = cells[i];
+                }
+            }
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,126 @@
+/**
+* @file Solver.h
+* @brief C++ interface of the lazymole library (in-memory inputs and outputs)
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_SOLVER_H
+#define LMA_SOLVER_H
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <functional>
+#include <atomic>
+
+namespace mla
+{
+    class CartesianGrid;
+    template<typename C> class CellField;
+}
+
+namespace lma
+{
+    struct GridSpec
+    {
+        GridSpec(const size_t nx, const size_t ny, const size_t nz,
+                 const double dx = 1.0, const double dy = 1.0, const double dz = 1.0)
+                : nx(nx), ny(ny), nz(nz), dx(dx), dy(dy), dz(dz) {}
+
+        size_t nx, ny, nz;
+        double dx, dy, dz;
+    };
+
+    struct Options
+    {
+        Options() : connectivity(0), log(false), epsilon(0.), stopAtTargets(false),
+                    maxResistance(std::numeric_limits<double>::max()) {}
+
+        size_t connectivity;  // Number of neighbors (0 for the full stencil)
+        bool log;             // True if the conductivity values are logK
+        double epsilon;       // Maximum relative error (0 for the exact algorithm)
+        bool stopAtTargets;   // Stop as soon as all the targets are settled
+        double maxResistance; // Stop as soon as the resistance exceeds this value
+    };
+
+    struct Result
+    {
+        double mhr;           // Minimum hydraulic resistance over the targets
+        size_t target;        // Target with the minimum resistance (number of cells if none is reached)
+        size_t pathLength;    // Number of cells of the least resistance path
+        double errorBound;    // Relative error bound (0 if exact)
+        bool cancelled;       // True if the run was cancelled (the resistances are final for the settled cells only)
+    };
+
+    struct Progress
+    {
+        size_t settled;       // Cells settled so far
+        size_t total;         // Cells of the grid
+        double resistance;    // Resistance of the front of the search
+        double elapsed;       // Seconds since the start of the run
+        double eta;           // Seconds left to settle all the cells at the current rate
+    };
+
+    /**
+     * The grid and the conductivity are set up once and can be used for many queries.
+     * Cell ids follow the layout of field.dat: id = idz*nx*ny + idy*nx + idx.
+     */
+    class Solver
+    {
+    public:
+
+        // conductivity holds one value per cell
+        Solver(const GridSpec& grid, const double* conductivity, const Options& options = Options());
+
+        ~Solver();
+
+        size_t numberOfCells() const;
+
+        const Options& getOptions() const;
+
+        // The log flag is used only when the solver is created
+        void setOptions(const Options& options);
+
+        // callback is called every nPops settled cells of each solve (empty to disable)
+        void setProgress(const std::function<void(const Progress&)>& callback, const size_t nPops = 65536);
+
+        // The solves stop as soon as *token is true, checked every nPops settled cells (null to disable)
+        void setCancellation(const std::atomic<bool>* token);
+
+        // resistance (if not null) receives one value per cell, the largest double for the cells not reached.
+        // path (if not null) receives up to pathCapacity cell ids, from the best target back to its source.
+        Result solve(const size_t* sources, const size_t nSources,
+                     const size_t* targets, const size_t nTargets,
+                     double* resistance = nullptr,
+                     size_t* path = nullptr, const size_t pathCapacity = 0) const;
+
+    private:
+
+        std::unique_ptr<mla::CartesianGrid> grid;
+        std::unique_ptr<mla::CellField<double>> field;
+        Options options;
+        std::function<void(const Progress&)> progress;
+        size_t progressPops;
+        const std::atomic<bool>* cancelToken;
+
+    };
+}
+
+#endif //LMA_SOLVER_H
@@ -0,0 +1,164 @@
+/**
+* @file lazymole.cpp
+* @brief C interface of the lazymole library
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string>
+#include <exception>
+#include <atomic>
+#include "Solver.h"
+#include "lazymole.h"
+
+struct lazymole_solver
+{
+    lma::Solver solver;
+    lazymole_progress_fn progress;
+    void* userData;
+    // Set when the callback asks to stop, cleared at each solve
+    mutable std::atomic<bool> isCancelled;
+
+    lazymole_solver(const lma::GridSpec& grid, const double* conductivity, const lma::Options& options)
+            : solver(grid, conductivity, options), progress(nullptr), userData(nullptr), isCancelled(false) {}
+};
+
+namespace
+{
+    thread_local std::string lastError;
+
+    int fail(const std::exception& e)
+    {
+        lastError = e.what();
+        return LAZYMOLE_ERROR;
+    }
+}
+
+lazymole_solver* lazymole_create(size_t nx, size_t ny, size_t nz,
+                                 double dx, double dy, double dz,
+                                 const double* conductivity, size_t connectivity)
+{
+    try
+    {
+        lma::Options options;
+        options.connectivity = connectivity;
+        return new lazymole_solver(lma::GridSpec(nx, ny, nz, dx, dy, dz), conductivity, options);
+    }
+    catch (const std::exception& e)
+    {
+        fail(e);
+        return nullptr;
+    }
+}
+
+void lazymole_destroy(lazymole_solver* solver)
+{
+    delete solver;
+}
+
+int lazymole_set_epsilon(lazymole_solver* solver, double epsilon)
+{
+    try
+    {
+        lma::Options options = solver->solver.getOptions();
+        options.epsilon = epsilon;
+        solver->solver.setOptions(options);
+        return LAZYMOLE_OK;
+    }
+    catch (const std::exception& e)
+    {
+        return fail(e);
+    }
+}
+
+int lazymole_set_termination(lazymole_solver* solver, int stop_at_targets, double max_resistance)
+{
+    try
+    {
+        lma::Options options = solver->solver.getOptions();
+        options.stopAtTargets = stop_at_targets != 0;
+        options.maxResistance = max_resistance;
+        solver->solver.setOptions(options);
+        return LAZYMOLE_OK;
+    }
+    catch (const std::exception& e)
+    {
+        return fail(e);
+    }
+}
+
+int lazymole_set_progress(lazymole_solver* solver, lazymole_progress_fn fn, void* user_data, size_t n_pops)
+{
+    try
+    {
+        solver->progress = fn;
+        solver->userData = user_data;
+        if (fn == nullptr)
+        {
+            solver->solver.setProgress(nullptr);
+            solver->solver.setCancellation(nullptr);
+            return LAZYMOLE_OK;
+        }
+        solver->solver.setProgress([solver](const lma::Progress& state)
+        {
+            if (solver->progress(state.settled, state.total, state.resistance, state.elapsed, state.eta,
+                                 solver->userData) != 0)
+            {
+                solver->isCancelled = true;
+            }
+        }, n_pops);
+        solver->solver.setCancellation(&solver->isCancelled);
+        return LAZYMOLE_OK;
+    }
+    catch (const std::exception& e)
+    {
+        return fail(e);
+    }
+}
+
+int lazymole_solve(const lazymole_solver* solver,
+                   const size_t* sources, size_t n_sources,
+                   const size_t* targets, size_t n_targets,
+                   double* resistance,
+                   size_t* path, size_t path_capacity, size_t* path_length,
+                   double* mhr, size_t* target)
+{
+    try
+    {
+        solver->isCancelled = false;
+        lma::Result result = solver->solver.solve(sources, n_sources, targets, n_targets,
+                                                  resistance, path, path_capacity);
+        if (path_length)
+            *path_length = result.pathLength;
+        if (mhr)
+            *mhr = result.mhr;
+        if (target)
+            *target = result.target;
+        return result.cancelled ? LAZYMOLE_CANCELLED : LAZYMOLE_OK;
+    }
+    catch (const std::exception& e)
+    {
+        return fail(e);
+    }
+}
+
+const char* lazymole_last_error(void)
+{
+    return lastError.c_str();
+}
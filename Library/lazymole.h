@@ -0,0 +1,104 @@
+/**
+* @file lazymole.h
+* @brief C interface of the lazymole library
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_LAZYMOLE_C_H
+#define LMA_LAZYMOLE_C_H
+
+#include <stddef.h>
+
+#if defined(_WIN32) && defined(LAZYMOLE_SHARED)
+#  if defined(LAZYMOLE_BUILD)
+#    define LAZYMOLE_API __declspec(dllexport)
+#  else
+#    define LAZYMOLE_API __declspec(dllimport)
+#  endif
+#else
+#  define LAZYMOLE_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Return codes */
+#define LAZYMOLE_OK 0
+#define LAZYMOLE_ERROR 1
+#define LAZYMOLE_CANCELLED 2
+
+typedef struct lazymole_solver lazymole_solver;
+
+/*
+ * Progress of a solve: cells settled, cells of the grid, resistance of the front of the search,
+ * seconds elapsed and seconds left at the current rate. A non zero return value cancels the solve.
+ */
+typedef int (*lazymole_progress_fn)(size_t settled, size_t total, double resistance,
+                                    double elapsed, double eta, void* user_data);
+
+/*
+ * Create a solver for a nx*ny*nz grid with cell sizes dx, dy, dz.
+ * conductivity holds one value per cell (id = idz*nx*ny + idy*nx + idx),
+ * connectivity is the number of neighbors (0 for the full stencil).
+ * Returns NULL on error (see lazymole_last_error).
+ */
+LAZYMOLE_API lazymole_solver* lazymole_create(size_t nx, size_t ny, size_t nz,
+                                              double dx, double dy, double dz,
+                                              const double* conductivity, size_t connectivity);
+
+LAZYMOLE_API void lazymole_destroy(lazymole_solver* solver);
+
+/* Relative error allowed (0 for the exact algorithm) */
+LAZYMOLE_API int lazymole_set_epsilon(lazymole_solver* solver, double epsilon);
+
+/* Early termination: stop at the targets (non zero) and/or at a maximum resistance */
+LAZYMOLE_API int lazymole_set_termination(lazymole_solver* solver, int stop_at_targets, double max_resistance);
+
+/*
+ * Call fn every n_pops settled cells of each solve (NULL to disable). The solves of one
+ * solver share the cancellation, a solver should not run two solves at once with a callback.
+ */
+LAZYMOLE_API int lazymole_set_progress(lazymole_solver* solver, lazymole_progress_fn fn, void* user_data, size_t n_pops);
+
+/*
+ * Compute the minimum hydraulic resistance from the sources.
+ * resistance (optional) receives one value per cell, path (optional) receives up to
+ * path_capacity cell ids from the best target back to its source. path_length, mhr and
+ * target (all optional) receive the full length of the path, the minimum resistance
+ * over the targets and the best target (number of cells if no target is reached).
+ * Returns LAZYMOLE_CANCELLED if the progress callback cancelled the solve: the outputs are
+ * then filled from the cells settled so far.
+ */
+LAZYMOLE_API int lazymole_solve(const lazymole_solver* solver,
+                                const size_t* sources, size_t n_sources,
+                                const size_t* targets, size_t n_targets,
+                                double* resistance,
+                                size_t* path, size_t path_capacity, size_t* path_length,
+                                double* mhr, size_t* target);
+
+/* Message of the last error of the calling thread */
+LAZYMOLE_API const char* lazymole_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LMA_LAZYMOLE_C_H */
@@ -0,0 +1,288 @@
+/**
+* @file Server.cpp
+* @brief Persistent query server answering MHR queries on a loaded field
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <limits>
+#include "Server.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+namespace lma
+{
+    Server::Server(mla::Grid* grid, mla::CellField<double>& field, const mla::ActiveCells* active,
+                   const size_t nWorkspaces, const double maxResistance)
+            : gridPtr(grid), field(field), activePtr(active), maxRes(maxResistance),
+              maxWorkspaces(nWorkspaces > 0 ? nWorkspaces : 1)
+    { }
+
+    Server::~Server() {}
+
+    mla::LazyMole* Server::acquire()
+    {
+        std::unique_lock<std::mutex> lock(poolMutex);
+        while (idle.empty() && workspaces.size() >= maxWorkspaces)
+        {
+            poolCondition.wait(lock);
+        }
+        if (!idle.empty())
+        {
+            mla::LazyMole* workspace = idle.back();
+            idle.pop_back();
+            return workspace;
+        }
+        workspaces.emplace_back(new mla::LazyMole(gridPtr, field, std::vector<size_t>(), activePtr));
+        workspaces.back()->setMaxResistance(maxRes);
+        return workspaces.back().get();
+    }
+
+    void Server::release(mla::LazyMole* workspace)
+    {
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            idle.push_back(workspace);
+        }
+        poolCondition.notify_one();
+    }
+
+    std::string Server::answer(const std::string& line)
+    {
+        std::istringstream request(line);
+        std::string command;
+        request >> command;
+
+        if (command.empty())
+        {
+            return "";
+        }
+        if (command == "info")
+        {
+            std::ostringstream out;
+            out << "ok " << gridPtr->numberOfCells();
+            return out.str();
+        }
+        if (command != "solve" && command != "path")
+        {
+            return "error unknown command '" + command + "'";
+        }
+
+        // Parse "<sources> ; <targets>"
+        std::vector<size_t> ids;
+        std::vector<size_t> idsTarget;
+        std::vector<size_t>* current = &ids;
+        std::string token;
+        while (request >> token)
+        {
+            if (token == ";")
+            {
+                if (current == &idsTarget)
+                    return "error too many ';'";
+                current = &idsTarget;
+                continue;
+            }
+            std::istringstream number(token);
+            size_t id;
+            if (!(number >> id) || !number.eof() || id >= gridPtr->numberOfCells())
+            {
+                return "error invalid cell id '" + token + "'";
+            }
+            current->push_back(id);
+        }
+        if (ids.empty() || idsTarget.empty())
+        {
+            return "error sources and targets are required ('" + command + " <sources> ; <targets>')";
+        }
+
+        mla::LazyMole* lazyMole = acquire();
+        std::ostringstream out;
+        try
+        {
+            lazyMole->reset(ids);
+            lazyMole->setTargets(idsTarget, false);
+            auto smallestRes = lazyMole->run();
+
+            double minRes = std::numeric_limits<double>::max();
+            size_t minId = gridPtr->numberOfCells();
+            for (auto id : idsTarget)
+            {
+                if (smallestRes->getFromCell(id) < minRes)
+                {
+                    minId = id;
+                    minRes = smallestRes->getFromCell(id);
+                }
+            }
+
+            out.precision(std::numeric_limits<double>::digits10);
+            if (minId == gridPtr->numberOfCells())
+            {
+                out << "ok inf " << minId << " 0";
+            }
+            else
+            {
+                auto cells = lazyMole->pathCells(minId);
+                out << "ok " << minRes << " " << minId << " " << cells.size();
+                if (command == "path")
+                {
+                    for (auto cell : cells)
+                        out << " " << cell;
+                }
+            }
+        }
+        catch (const std::exception& e)
+        {
+            release(lazyMole);
+            return std::string("error ") + e.what();
+        }
+        release(lazyMole);
+        return out.str();
+    }
+
+    void Server::serve(std::istream& inStream, std::ostream& outStream)
+    {
+        std::string line;
+        while (std::getline(inStream, line))
+        {
+            if (line == "quit")
+                break;
+            outStream << answer(line) << std::endl;
+        }
+    }
+
+#ifndef _WIN32
+
+    void Server::serveConnection(int fd)
+    {
+        std::string buffer;
+        char chunk[4096];
+        bool isOpen = true;
+        while (isOpen)
+        {
+            const ssize_t n = read(fd, chunk, sizeof(chunk));
+            if (n <= 0)
+                break;
+            buffer.append(chunk, static_cast<size_t>(n));
+
+            size_t end;
+            while ((end = buffer.find('\n')) != std::string::npos)
+            {
+                std::string line = buffer.substr(0, end);
+                buffer.erase(0, end + 1);
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                if (line == "quit")
+                {
+                    isOpen = false;
+                    break;
+                }
+
+                const std::string reply = answer(line) + "\n";
+                size_t written = 0;
+                while (written < reply.size())
+                {
+                    const ssize_t w = send(fd, reply.data() + written, reply.size() - written, MSG_NOSIGNAL);
+                    if (w <= 0)
+                    {
+                        isOpen = false;
+                        break;
+                    }
+                    written += static_cast<size_t>(w);
+                }
+                if (!isOpen)
+                    break;
+            }
+        }
+        close(fd);
+    }
+
+    void Server::serveSocket(const std::string& socketPath)
+    {
+        sockaddr_un address;
+        if (socketPath.size() >= sizeof(address.sun_path))
+        {
+            throw std::runtime_error("ERROR: socket path too long " + socketPath);
+        }
+
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            throw std::runtime_error("ERROR: cannot create the socket");
+        }
+
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+        unlink(socketPath.c_str());
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, 64) < 0)
+        {
+            close(fd);
+            throw std::runtime_error("ERROR: cannot listen on the socket " + socketPath);
+        }
+
+        // An aborted connection or a signal is retried at once. Running out of descriptors or memory
+        // may pass when other connections close: it is reported and retried after a pause.
+        while (true)
+        {
+            const int client = accept(fd, nullptr, nullptr);
+            if (client < 0)
+            {
+                const int error = errno;
+                if (error == EINTR || error == ECONNABORTED)
+                    continue;
+                if (error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM)
+                {
+                    std::cerr << "WARNING: cannot accept a connection on the socket " << socketPath << " ("
+                              << std::strerror(error) << "), retrying in 1 s" << std::endl;
+                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                    continue;
+                }
+                close(fd);
+                throw std::runtime_error("ERROR: cannot accept connections on the socket " + socketPath + " (" +
+                                         std::strerror(error) + ")");
+            }
+            std::thread(&Server::serveConnection, this, client).detach();
+        }
+    }
+
+#else
+
+    void Server::serveConnection(int)
+    { }
+
+    void Server::serveSocket(const std::string&)
+    {
+        throw std::runtime_error("ERROR: Unix domain sockets are not supported on this platform");
+    }
+
+#endif
+}
@@ -0,0 +1,93 @@
+/**
+* @file Server.h
+* @brief Persistent query server answering MHR queries on a loaded field
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_SERVER_H
+#define LMA_SERVER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include <CellField.h>
+#include <ActiveCellField.h>
+#include <LazyMole.h>
+
+namespace lma
+{
+    /**
+     * Line protocol (one request per line, one answer per line):
+     *   info                           -> ok <number of cells>
+     *   solve <sources> ; <targets>    -> ok <mhr> <target> <path length>
+     *   path <sources> ; <targets>     -> ok <mhr> <target> <path length> <path cell ids>
+     *   quit                           -> closes the connection
+     * Errors are answered with "error <message>". The search stops at the first
+     * settled target, i.e. the target with the minimum resistance, or when the
+     * resistance exceeds maxResistance: then no target is reached and the answer
+     * is "ok inf <number of cells> 0".
+     */
+    class Server
+    {
+    public:
+
+        Server(mla::Grid* grid, mla::CellField<double>& field, const mla::ActiveCells* active,
+               const size_t nWorkspaces, const double maxResistance = std::numeric_limits<double>::max());
+
+        ~Server();
+
+        // Answer a single request
+        std::string answer(const std::string& line);
+
+        // Answer the requests read from inStream until "quit" or the end of the stream
+        void serve(std::istream& inStream, std::ostream& outStream);
+
+        // Listen on a Unix domain socket, each connection is served by its own thread
+        void serveSocket(const std::string& socketPath);
+
+    private:
+
+        mla::LazyMole* acquire();
+
+        void release(mla::LazyMole* workspace);
+
+        void serveConnection(int fd);
+
+        mla::Grid* gridPtr;
+        mla::CellField<double>& field;
+        const mla::ActiveCells* activePtr;
+
+        double maxRes;
+
+        // Pool of solvers reused between requests (created on demand)
+        size_t maxWorkspaces;
+        std::vector<std::unique_ptr<mla::LazyMole>> workspaces;
+        std::vector<mla::LazyMole*> idle;
+        std::mutex poolMutex;
+        std::condition_variable poolCondition;
+    };
+}
+
+#endif //LMA_SERVER_H
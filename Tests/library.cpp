@@ -0,0 +1,302 @@
+/**
+* @file library.cpp
+* @brief Tests of the C++ and C interfaces of the library against the outputs of lazyMole
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <CartesianGrid.h>
+#include <Input.h>
+#include <Regions.h>
+#include <Streams.h>
+#include <Solver.h>
+#include <lazymole.h>
+
+/**
+ * Example1 is solved through lma::Solver and through the C API and compared with the reference
+ * outputs of lazyMole (resistance map and least resistance path), then the errors and the
+ * cancellation of both interfaces are checked.
+ *
+ * usage: library EXAMPLES_DIR
+ */
+
+namespace
+{
+    // Outputs written with the default precision (6 significant digits)
+    const double OUTPUT_PRECISION = 1e-5;
+
+    struct Example
+    {
+        size_t nx, ny, nz;
+        double dx, dy, dz;
+        size_t connectivity;
+        std::vector<double> logK;
+        std::vector<size_t> sources;
+        std::vector<size_t> targets;
+        std::vector<double> res;                  // Reference resistance map
+        std::vector<std::vector<double>> path;    // Reference path, centers of the cells
+    };
+
+    int nFailed = 0;
+
+    void check(const bool condition, const std::string& message)
+    {
+        if (!condition)
+        {
+            std::cerr << "ERROR: " << message << std::endl;
+            nFailed++;
+        }
+    }
+
+    std::vector<double> readValues(const std::string& name, const size_t skip)
+    {
+        std::ifstream inFile(name);
+        if (!inFile)
+            throw std::runtime_error("ERROR: cannot read '" + name + "'");
+        std::string line;
+        for (size_t i = 0; i < skip; i++)
+            std::getline(inFile, line);
+        std::vector<double> values;
+        double value;
+        while (inFile >> value)
+            values.push_back(value);
+        return values;
+    }
+
+    Example load(const std::string& folder)
+    {
+        lma::Input config(folder + "config.yaml");
+        if (config.refx() != 1 || config.refy() != 1 || config.refz() != 1)
+            throw std::runtime_error("ERROR: the library does not support refined grids");
+        Example example;
+        example.nx = config.nx();
+        example.ny = config.ny();
+        example.nz = config.nz();
+        example.dx = config.dx();
+        example.dy = config.dy();
+        example.dz = config.dz();
+        example.connectivity = config.connectivity();
+        example.logK = readValues(lma::resolvePath(folder, config.field()), config.fieldSkip());
+        if (!config.fieldLog())
+        {
+            for (auto& value : example.logK)
+                value = std::log(value);
+        }
+        mla::CartesianGrid grid(example.nx, example.ny, example.nz, example.dx, example.dy, example.dz);
+        example.sources = lma::loadRegion(config, "source", folder, &grid);
+        example.targets = lma::loadRegion(config, "target", folder, &grid);
+        example.res = readValues(lma::resolvePath(folder, config.outputRes()), 0);
+
+        std::ifstream pathFile(lma::resolvePath(folder, config.outputPath()));
+        std::string line;
+        while (std::getline(pathFile, line))
+        {
+            std::replace(line.begin(), line.end(), ',', ' ');
+            std::istringstream fields(line);
+            std::vector<double> center(3);
+            if (fields >> center[0] >> center[1] >> center[2])
+                example.path.push_back(center);
+        }
+        if (example.logK.size() != example.nx * example.ny * example.nz || example.res.size() != example.logK.size() ||
+            example.path.empty())
+            throw std::runtime_error("ERROR: cannot read the example in '" + folder + "'");
+        return example;
+    }
+
+    // Compare a solution with the outputs of lazyMole
+    void compare(const Example& example, const std::string& label, const std::vector<double>& res,
+                 const std::vector<size_t>& path, const size_t pathLength, const double mhr)
+    {
+        size_t nDifferent = 0;
+        for (size_t id = 0; id < res.size(); id++)
+        {
+            const double expected = example.res[id];
+            if (!(std::abs(res[id] - expected) <= OUTPUT_PRECISION * std::max(std::abs(expected), 1e-12)))
+                nDifferent++;
+        }
+        check(nDifferent == 0, label + ": " + std::to_string(nDifferent) + " resistances differ from lazyMole");
+
+        double expectedMhr = std::numeric_limits<double>::max();
+        for (auto id : example.targets)
+            expectedMhr = std::min(expectedMhr, example.res[id]);
+        check(std::abs(mhr - expectedMhr) <= OUTPUT_PRECISION * expectedMhr, label + ": MHR " + std::to_string(mhr) +
+              " instead of " + std::to_string(expectedMhr));
+
+        bool isSame = pathLength == example.path.size() && path.size() >= pathLength;
+        for (size_t i = 0; isSame && i < pathLength; i++)
+        {
+            const size_t cell = path[i];
+            const double center[3] = {(cell % example.nx + 0.5) * example.dx,
+                                      (cell / example.nx % example.ny + 0.5) * example.dy,
+                                      (cell / (example.nx * example.ny) + 0.5) * example.dz};
+            for (size_t d = 0; d < 3; d++)
+                isSame = isSame && std::abs(center[d] - example.path[i][d]) < 1e-9;
+        }
+        check(isSame, label + ": least resistance path differs from lazyMole");
+    }
+
+    void testSolver(const Example& example)
+    {
+        lma::Options options;
+        options.connectivity = example.connectivity;
+        options.log = true;
+        lma::Solver solver(lma::GridSpec(example.nx, example.ny, example.nz, example.dx, example.dy, example.dz),
+                           example.logK.data(), options);
+        std::vector<double> res(solver.numberOfCells());
+        std::vector<size_t> path(solver.numberOfCells());
+        size_t nReports = 0;
+        solver.setProgress([&nReports](const lma::Progress&) { nReports++; }, 1000);
+        auto result = solver.solve(example.sources.data(), example.sources.size(),
+                                   example.targets.data(), example.targets.size(),
+                                   res.data(), path.data(), path.size());
+        check(!result.cancelled && result.errorBound == 0., "Solver: the exact solve was cancelled or approximate");
+        check(nReports > 0, "Solver: the progress was never reported");
+        compare(example, "Solver", res, path, result.pathLength, result.mhr);
+
+        // Errors are exceptions
+        const size_t outside = solver.numberOfCells();
+        bool isThrown = false;
+        try
+        {
+            solver.solve(&outside, 1, example.targets.data(), example.targets.size());
+        }
+        catch (const std::out_of_range&)
+        {
+            isThrown = true;
+        }
+        check(isThrown, "Solver: a source outside the grid is accepted");
+        isThrown = false;
+        try
+        {
+            lma::Solver invalid(lma::GridSpec(example.nx, example.ny, example.nz), nullptr);
+        }
+        catch (const std::invalid_argument&)
+        {
+            isThrown = true;
+        }
+        check(isThrown, "Solver: a missing conductivity is accepted");
+
+        // A cancelled solve ends early with the settled cells only
+        std::atomic<bool> isCancelRequested(true);
+        solver.setProgress([](const lma::Progress&) {}, 100);
+        solver.setCancellation(&isCancelRequested);
+        result = solver.solve(example.sources.data(), example.sources.size(),
+                              example.targets.data(), example.targets.size(), res.data());
+        const size_t nReached = std::count_if(res.begin(), res.end(), [](const double value)
+        {
+            return value < std::numeric_limits<double>::max();
+        });
+        check(result.cancelled && nReached < res.size(), "Solver: the cancellation does not stop the solve");
+        solver.setCancellation(nullptr);
+        solver.setProgress(nullptr);
+    }
+
+    int cancelAfterFirstReport(size_t, size_t, double, double, double, void* userData)
+    {
+        ++*static_cast<size_t*>(userData);
+        return 1;
+    }
+
+    void testCInterface(const Example& example)
+    {
+        std::vector<double> k(example.logK.size());
+        for (size_t id = 0; id < k.size(); id++)
+            k[id] = std::exp(example.logK[id]);
+        lazymole_solver* solver = lazymole_create(example.nx, example.ny, example.nz, example.dx, example.dy,
+                                                  example.dz, k.data(), example.connectivity);
+        check(solver != nullptr, std::string("C API: lazymole_create failed: ") + lazymole_last_error());
+        if (solver == nullptr)
+            return;
+
+        std::vector<double> res(k.size());
+        std::vector<size_t> path(k.size());
+        size_t pathLength = 0;
+        size_t target = 0;
+        double mhr = 0.;
+        int status = lazymole_solve(solver, example.sources.data(), example.sources.size(),
+                                    example.targets.data(), example.targets.size(), res.data(),
+                                    path.data(), path.size(), &pathLength, &mhr, &target);
+        check(status == LAZYMOLE_OK, std::string("C API: lazymole_solve failed: ") + lazymole_last_error());
+        check(target < k.size() && res[target] == mhr, "C API: the best target does not have the MHR");
+        compare(example, "C API", res, path, pathLength, mhr);
+
+        // Errors are return codes with a message
+        const size_t outside = k.size();
+        status = lazymole_solve(solver, &outside, 1, example.targets.data(), example.targets.size(),
+                                nullptr, nullptr, 0, nullptr, nullptr, nullptr);
+        check(status == LAZYMOLE_ERROR && std::string(lazymole_last_error()).find("source") != std::string::npos,
+              "C API: a source outside the grid is accepted");
+        check(lazymole_create(example.nx, example.ny, example.nz, 1., 1., 1., nullptr, 0) == nullptr &&
+              std::string(lazymole_last_error()).find("conductivity") != std::string::npos,
+              "C API: a missing conductivity is accepted");
+
+        // A non zero return value of the callback cancels the solve, the next solve runs again
+        size_t nReports = 0;
+        lazymole_set_progress(solver, cancelAfterFirstReport, &nReports, 100);
+        status = lazymole_solve(solver, example.sources.data(), example.sources.size(),
+                                example.targets.data(), example.targets.size(), res.data(),
+                                nullptr, 0, nullptr, nullptr, nullptr);
+        check(status == LAZYMOLE_CANCELLED && nReports == 1, "C API: the callback does not cancel the solve");
+
+        // The only report comes with the last cell settled: the solve is cancelled all the same
+        nReports = 0;
+        lazymole_set_progress(solver, cancelAfterFirstReport, &nReports, k.size());
+        status = lazymole_solve(solver, example.sources.data(), example.sources.size(),
+                                example.targets.data(), example.targets.size(), res.data(),
+                                nullptr, 0, nullptr, nullptr, nullptr);
+        check(status == LAZYMOLE_CANCELLED && nReports == 1,
+              "C API: the callback of the last cell settled does not cancel the solve");
+        lazymole_set_progress(solver, nullptr, nullptr, 0);
+        status = lazymole_solve(solver, example.sources.data(), example.sources.size(),
+                                example.targets.data(), example.targets.size(), res.data(),
+                                path.data(), path.size(), &pathLength, &mhr, nullptr);
+        check(status == LAZYMOLE_OK, "C API: the solve after a cancelled one failed");
+        compare(example, "C API after a cancelled solve", res, path, pathLength, mhr);
+        lazymole_destroy(solver);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc != 2)
+            throw std::runtime_error("ERROR: usage: library EXAMPLES_DIR");
+        const Example example = load(std::string(argv[1]) + "/Example1/");
+        testSolver(example);
+        testCInterface(example);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << (nFailed == 0 ? "OK" : "FAILED") << std::endl;
+    return nFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+/**
+* @file regions.cpp
+* @brief Test of the cells of the geometric source and target regions
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <CartesianGrid.h>
+#include <CellRegion.h>
+#include <Input.h>
+#include <Regions.h>
+
+/**
+ * The ids of each primitive (boxes clipped by the domain, points with repetitions, segments
+ * along an axis, diagonal and of zero length) on small grids are compared with the expected
+ * ones, the cells crossed by the segments with the cells of many points along them. The
+ * regions of a configuration are loaded with lma::loadRegion.
+ *
+ * usage: regions WORK_DIR
+ */
+
+namespace
+{
+    // Points along a segment to find the cells it crosses
+    const size_t SEGMENT_SAMPLES = 100000;
+
+    int nFailed = 0;
+
+    std::string print(const std::vector<size_t>& ids)
+    {
+        std::ostringstream out;
+        for (size_t i = 0; i < ids.size(); i++)
+            out << (i > 0 ? " " : "") << ids[i];
+        return "{" + out.str() + "}";
+    }
+
+    // The ids in this order
+    void checkIds(const std::string& name, const std::vector<size_t>& ids, const std::vector<size_t>& expected)
+    {
+        if (ids != expected)
+        {
+            std::cerr << "ERROR: " << name << ": " << print(ids) << " instead of " << print(expected) << std::endl;
+            nFailed++;
+        }
+    }
+
+    // The ids in any order, each once
+    void checkSet(const std::string& name, const std::vector<size_t>& ids, std::vector<size_t> expected)
+    {
+        std::vector<size_t> sorted(ids);
+        std::sort(sorted.begin(), sorted.end());
+        std::sort(expected.begin(), expected.end());
+        checkIds(name, sorted, expected);
+    }
+
+    std::vector<size_t> boxCells(const mla::CartesianGrid& grid, const mla::Point3D& lower, const mla::Point3D& upper)
+    {
+        mla::CellRegion region(&grid);
+        region.addBox(lower, upper);
+        return region.cells();
+    }
+
+    std::vector<size_t> segmentCells(const mla::CartesianGrid& grid, const mla::Point3D& a, const mla::Point3D& b)
+    {
+        mla::CellRegion region(&grid);
+        region.addSegment(a, b);
+        return region.cells();
+    }
+
+    // Cells of the points along the segment, in the order they are crossed
+    std::vector<size_t> sampledCells(const mla::CartesianGrid& grid, const mla::Point3D& a, const mla::Point3D& b)
+    {
+        std::vector<size_t> cells;
+        for (size_t s = 0; s <= SEGMENT_SAMPLES; s++)
+        {
+            const double t = static_cast<double>(s) / SEGMENT_SAMPLES;
+            const size_t cell = grid.idCell(mla::Point3D(a.get(0) + t * (b.get(0) - a.get(0)),
+                                                         a.get(1) + t * (b.get(1) - a.get(1)),
+                                                         a.get(2) + t * (b.get(2) - a.get(2))));
+            if (cells.empty() || cells.back() != cell)
+                cells.push_back(cell);
+        }
+        return cells;
+    }
+
+    void testBoxes()
+    {
+        // Centers at x = 0.5 ... 4.5, y = 1 ... 7, z = 0.25 ... 1.25
+        mla::CartesianGrid grid(5, 4, 3, 1.0, 2.0, 0.5);
+        const std::vector<size_t> corner = {grid.mergeIds(0, 0, 0), grid.mergeIds(1, 0, 0),
+                                            grid.mergeIds(0, 1, 0), grid.mergeIds(1, 1, 0)};
+        checkSet("box clipped at the lower corner", boxCells(grid, mla::Point3D(-10., -10., -10.),
+                                                             mla::Point3D(1.5, 3.0, 0.3)), corner);
+        checkSet("box with swapped corners", boxCells(grid, mla::Point3D(1.5, 3.0, 0.3),
+                                                      mla::Point3D(-10., -10., -10.)), corner);
+        checkSet("box clipped at the upper corner", boxCells(grid, mla::Point3D(3.2, 6.0, 1.0),
+                                                             mla::Point3D(100., 100., 100.)),
+                 {grid.mergeIds(3, 3, 2), grid.mergeIds(4, 3, 2)});
+        std::vector<size_t> all(grid.numberOfCells());
+        for (size_t cell = 0; cell < all.size(); cell++)
+            all[cell] = cell;
+        checkIds("box larger than the domain", boxCells(grid, mla::Point3D(-1., -1., -1.), mla::Point3D(10., 10., 10.)),
+                 all);
+        checkSet("box outside the domain", boxCells(grid, mla::Point3D(6., 0., 0.), mla::Point3D(9., 8., 1.5)), {});
+        checkSet("box between two centers", boxCells(grid, mla::Point3D(0.6, 0., 0.), mla::Point3D(1.4, 8., 1.5)), {});
+
+        mla::CellRegion outside(&grid);
+        outside.addBox(mla::Point3D(6., 0., 0.), mla::Point3D(9., 8., 1.5));
+        if (!outside.empty())
+        {
+            std::cerr << "ERROR: a box outside the domain is not empty" << std::endl;
+            nFailed++;
+        }
+
+        // Overlapping boxes, points inside them and listed cells
+        mla::CellRegion region(&grid);
+        region.addCells({grid.mergeIds(2, 3, 1), grid.mergeIds(2, 3, 1), grid.mergeIds(1, 0, 0)});
+        region.addBox(mla::Point3D(-10., -10., -10.), mla::Point3D(1.5, 3.0, 0.3));
+        region.addBox(mla::Point3D(0., 0., 0.), mla::Point3D(2.5, 2.0, 0.5));
+        region.addPoint(mla::Point3D(0.5, 1.0, 0.25));
+        region.addPoint(mla::Point3D(4.5, 7.0, 1.25));
+        checkIds("listed cells, boxes and points", region.cells(),
+                 {grid.mergeIds(2, 3, 1), grid.mergeIds(2, 3, 1), grid.mergeIds(1, 0, 0),
+                  grid.mergeIds(0, 0, 0), grid.mergeIds(0, 1, 0), grid.mergeIds(1, 1, 0),
+                  grid.mergeIds(2, 0, 0), grid.mergeIds(4, 3, 2)});
+    }
+
+    void testPoints()
+    {
+        mla::CartesianGrid grid(5, 4, 3, 1.0, 2.0, 0.5);
+        mla::CellRegion region(&grid);
+        // The second point is on the upper corner of the domain, the last one is in the same cell
+        region.addPoints({mla::Point3D(0.5, 1.0, 0.25), mla::Point3D(5.0, 8.0, 1.5), mla::Point3D(0.2, 0.3, 0.1),
+                          mla::Point3D(2.7, 4.1, 0.9), mla::Point3D(4.9, 7.9, 1.4)});
+        checkIds("points with repetitions", region.cells(),
+                 {grid.mergeIds(0, 0, 0), grid.mergeIds(4, 3, 2), grid.mergeIds(2, 2, 1)});
+
+        bool isThrown = false;
+        try
+        {
+            region.addPoint(mla::Point3D(5.1, 1.0, 0.25));
+        }
+        catch (const std::invalid_argument&)
+        {
+            isThrown = true;
+        }
+        if (!isThrown)
+        {
+            std::cerr << "ERROR: a point outside the domain is accepted" << std::endl;
+            nFailed++;
+        }
+    }
+
+    void testSegments()
+    {
+        mla::CartesianGrid grid(5, 4, 3, 1.0, 2.0, 0.5);
+        checkIds("segment of zero length", segmentCells(grid, mla::Point3D(2.3, 3.1, 0.6), mla::Point3D(2.3, 3.1, 0.6)),
+                 {grid.mergeIds(2, 1, 1)});
+        checkIds("segment along x", segmentCells(grid, mla::Point3D(0.5, 1.0, 0.25), mla::Point3D(4.5, 1.0, 0.25)),
+                 {grid.mergeIds(0, 0, 0), grid.mergeIds(1, 0, 0), grid.mergeIds(2, 0, 0), grid.mergeIds(3, 0, 0),
+                  grid.mergeIds(4, 0, 0)});
+        checkIds("segment along z inside one column", segmentCells(grid, mla::Point3D(3.5, 5.0, 1.4),
+                                                                   mla::Point3D(3.5, 5.0, 0.1)),
+                 {grid.mergeIds(3, 2, 2), grid.mergeIds(3, 2, 1), grid.mergeIds(3, 2, 0)});
+
+        // Diagonals in both directions, with the upper end on the boundary of the domain
+        const std::vector<std::pair<mla::Point3D, mla::Point3D>> diagonals = {
+            {mla::Point3D(0.3, 0.7, 0.1), mla::Point3D(4.6, 7.3, 1.4)},
+            {mla::Point3D(4.6, 7.3, 1.4), mla::Point3D(0.3, 0.7, 0.1)},
+            {mla::Point3D(0.1, 6.9, 0.35), mla::Point3D(5.0, 0.45, 1.1)},
+            {mla::Point3D(1.35, 0.2, 1.45), mla::Point3D(3.85, 7.7, 0.05)}};
+        for (const auto& diagonal : diagonals)
+        {
+            std::ostringstream name;
+            name << "diagonal segment from " << diagonal.first << " to " << diagonal.second;
+            checkSet(name.str(), segmentCells(grid, diagonal.first, diagonal.second),
+                     sampledCells(grid, diagonal.first, diagonal.second));
+        }
+
+        mla::CartesianGrid grid2d(6, 5, 1, 1.0, 1.0, 1.0);
+        checkSet("2D diagonal segment", segmentCells(grid2d, mla::Point3D(0.2, 0.9, 0.5), mla::Point3D(5.7, 4.1, 0.5)),
+                 sampledCells(grid2d, mla::Point3D(0.2, 0.9, 0.5), mla::Point3D(5.7, 4.1, 0.5)));
+    }
+
+    void testConfiguration(const std::string& folder)
+    {
+        // 2D grid: boxes, points and segments without z
+        const std::string name = folder + "/regions.yaml";
+        std::ofstream configFile(name);
+        configFile << "grid:\n    dimensions:\n        nx: 6\n        ny: 5\n        nz: 1\n"
+                   << "    cell size:\n        dx: 1.0\n        dy: 1.0\n        dz: 1.0\n"
+                   << "input:\n"
+                   << "    source:\n        box: [0.2, 0.2, 1.8, 1.2]\n        points: [[0.5, 0.5], [5.5, 4.5], [5.5, 4.5]]\n"
+                   << "    target:\n        face: [xmax, ymin]\n        segment: [0.5, 4.5, 3.5, 4.5]\n";
+        configFile.close();
+        if (!configFile)
+            throw std::runtime_error("ERROR: cannot write '" + name + "'");
+
+        // The boxes first (in their order), then the points and segments, each cell once
+        lma::Input config(name);
+        mla::CartesianGrid grid(6, 5, 1, 1.0, 1.0, 1.0);
+        checkIds("sources of the configuration", lma::loadRegion(config, "source", folder, &grid), {0, 1, 29});
+        checkIds("targets of the configuration", lma::loadRegion(config, "target", folder, &grid),
+                 {5, 11, 17, 23, 29, 0, 1, 2, 3, 4, 24, 25, 26, 27});
+
+        const std::string invalidName = folder + "/invalid_regions.yaml";
+        std::ofstream invalidFile(invalidName);
+        invalidFile << "input:\n    source:\n        box: [0, 0, 0, 1, 1]\n";
+        invalidFile.close();
+        lma::Input invalid(invalidName);
+        bool isThrown = false;
+        try
+        {
+            lma::loadRegion(invalid, "source", folder, &grid);
+        }
+        catch (const std::runtime_error&)
+        {
+            isThrown = true;
+        }
+        if (!isThrown)
+        {
+            std::cerr << "ERROR: a box with 5 coordinates is accepted" << std::endl;
+            nFailed++;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc != 2)
+            throw std::runtime_error("ERROR: usage: regions WORK_DIR");
+        testBoxes();
+        testPoints();
+        testSegments();
+        testConfiguration(argv[1]);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << (nFailed == 0 ? "OK" : "FAILED") << std::endl;
+    return nFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,1147 @@
+/**
+* @file regression.cpp
+* @brief Golden output regression and performance tracking of the engines and modes of lazyMole
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <ctime>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <limits>
+#include <CartesianGrid.h>
+#include <Input.h>
+#include <Regions.h>
+#include <Streams.h>
+
+/**
+ * One problem (an example with its reference outputs, or a synthetic field) is solved by every
+ * variant: queues, stencils, parallel engines and modes of lazyMole. Each run is a child
+ * process, so its wall time and peak memory are measured alone and appended to the history file.
+ * A run slower (or larger) than the median of its previous runs is reported as a regression.
+ *
+ * usage: regression [options] problem
+ *     --lazymole BIN       lazyMole executable
+ *     --examples DIR       folder of Example1-3
+ *     --work DIR           scratch folder (one subfolder per problem and variant)
+ *     --history FILE       performance history ("time problem/variant seconds peakKB status" lines)
+ *     --mpi BIN            lazyMoleMPI executable (optional)
+ *     --mpiexec EXE        launcher of lazyMoleMPI, followed by any number of --mpiflag FLAG
+ *     --strict             fail on performance regressions too (they are only reported otherwise)
+ */
+
+namespace
+{
+    // How the outputs of a variant are compared with the reference
+    enum Check
+    {
+        EXACT,       // resistance map (relative 1e-9) and least resistance path (identical)
+        APPROXIMATE, // resistance map and MHR within the tolerance
+        BEST,        // MHR (relative 1e-9) and least resistance path: the other cells need not be final
+        SAME,        // a file identical to the one of another variant
+        ENSEMBLE,    // resistance maps and paths of each realization
+        CORRIDOR,    // BEST, corridor mask and slack from the reference map and a search from the targets
+        PATHS,       // paths of all the targets, the union of the paths of the searches of each target
+        LABELS,      // source labels and best source of each target, the nearest source of the searches of each source
+        ATTRIBUTES,  // EXACT, attributes of the cells of the path recomputed from its centers and the field
+        CONNECTIVITY // indicator of a few cells, the MHR of the search from each of them to the shell of its window
+    };
+
+    struct Variant
+    {
+        std::string name;
+        std::string solver;     // Lines of the solver section (no section if empty)
+        std::string sections;   // Other top level sections
+        std::string outputs;    // Other lines of the output section
+        Check check;
+        double tolerance;
+        size_t runs;            // The runs after the first one reuse its state (cache)
+        bool tiled;             // Convert the field into a tile file first
+        bool lazy;              // Read the tiles when the search reaches them
+        bool mpi;
+        bool fullStencil;       // No connectivity key (problems with the full stencil only)
+        bool interrupted;       // The checkpoint of the first run is cut as by a crash, the second run resumes it
+        std::string file;       // SAME: file compared with the one of the variant reference
+        std::string reference;
+    };
+
+    struct Problem
+    {
+        size_t nx, ny, nz;
+        double dx, dy, dz;
+        size_t refx, refy, refz;
+        size_t connectivity;
+        std::string field;
+        size_t skip;
+        bool log;
+        std::string source;     // Lines of the source and target sections
+        std::string target;
+        std::string res;        // Reference outputs (the dijkstra variant for the synthetic problems)
+        std::string path;
+    };
+
+    struct Settings
+    {
+        std::string lazyMole;
+        std::string examples;
+        std::string work;
+        std::string history;
+        std::string mpi;
+        std::vector<std::string> mpiexec;
+        bool strict = false;
+    };
+
+    struct Usage
+    {
+        double seconds;
+        long peakKB;
+    };
+
+    const double INF_THRESHOLD = 1e300;
+
+    const size_t MPI_PROCESSES = 3;
+
+    const double CORRIDOR_TOLERANCE = 0.05;
+
+    // Targets of the PATHS check and sources of the LABELS check, each one also solved alone
+    const size_t SINGLE_RUNS = 4;
+
+    const size_t CONNECTIVITY_RADIUS = 3;
+
+    // Outputs written with the default precision (6 significant digits)
+    const double OUTPUT_PRECISION = 1e-5;
+
+    std::vector<Variant> variants()
+    {
+        auto variant = [](const std::string& name, const std::string& solver, const Check check)
+        {
+            Variant v;
+            v.name = name;
+            v.solver = solver;
+            v.check = check;
+            v.tolerance = 1e-9;
+            v.runs = 1;
+            v.tiled = false;
+            v.lazy = false;
+            v.mpi = false;
+            v.fullStencil = false;
+            v.interrupted = false;
+            return v;
+        };
+        std::vector<Variant> list;
+        list.push_back(variant("dijkstra", "    queue: heap\n", EXACT));
+        // The sections of the configuration that are optional since the first version
+        list.push_back(variant("no_solver", "", EXACT));
+        list.push_back(variant("no_connectivity", "", EXACT));
+        list.back().fullStencil = true;
+        list.push_back(variant("stop_targets", "    stop:\n        targets: true\n", BEST));
+        list.push_back(variant("bucket", "    queue: bucket\n    epsilon: 0.01\n", APPROXIMATE));
+        list.back().tolerance = 0.01;
+        list.push_back(variant("multilevel", "    multilevel:\n        factor: 4\n"
+                               "        averaging: geometric\n        corridor: 1\n        verify: true\n", BEST));
+        list.push_back(variant("corridor", "    corridor:\n        tolerance: " +
+                               std::to_string(CORRIDOR_TOLERANCE) + "\n", CORRIDOR));
+        list.push_back(variant("paths", "", PATHS));
+        list.back().outputs = "    paths:\n        file: paths.dat\n";
+        list.push_back(variant("labels", "", LABELS));
+        list.back().outputs = "    labels:\n        file: labels.dat\n        targets: label_targets.dat\n";
+        list.push_back(variant("attributes", "", ATTRIBUTES));
+        list.back().outputs = "    attributes:\n        length: length.dat\n        steps: steps.dat\n"
+                              "        minK: mink.dat\n        maxK: maxk.dat\n";
+        // The second run loads the map from the cache and rebuilds the attributes from the tree
+        list.push_back(variant("attributes_cache", "    cache: result.cache\n", ATTRIBUTES));
+        list.back().outputs = list[list.size() - 2].outputs;
+        list.back().runs = 2;
+        list.push_back(variant("checkpoint", "    checkpoint:\n        file: checkpoint.dat\n"
+                               "        cells: 5000\n        seconds: 0\n        resume: false\n", EXACT));
+        list.push_back(variant("checkpoint_resume", "    checkpoint:\n        file: checkpoint.dat\n"
+                               "        cells: 2000\n        seconds: 0\n        resume: true\n", EXACT));
+        list.back().runs = 2;
+        list.back().interrupted = true;
+        list.push_back(variant("checkpoint_bucket", "    queue: bucket\n    epsilon: 0.01\n"
+                               "    checkpoint:\n        file: checkpoint.dat\n        cells: 2000\n        seconds: 0\n"
+                               "        resume: true\n", APPROXIMATE));
+        list.back().tolerance = 0.01;
+        list.back().runs = 2;
+        list.back().interrupted = true;
+        list.push_back(variant("cache", "    cache: result.cache\n", EXACT));
+        list.back().runs = 2;
+        list.push_back(variant("memory", "", EXACT));
+        list.back().sections = "memory:\n    pages: transparent\n    threads: 2\n";
+        list.push_back(variant("tiles", "    threads: 4\n", EXACT));
+        list.back().tiled = true;
+        list.push_back(variant("tiles_lazy", "    stop:\n        targets: true\n", BEST));
+        list.back().tiled = true;
+        list.back().lazy = true;
+        list.push_back(variant("ensemble", "", ENSEMBLE));
+        list.back().sections = "ensemble:\n    realizations: 2\n    field: field_{}.dat\n    resistance: hres_{}.dat\n"
+                               "    path: path_{}.dat\n    summary: ensemble.dat\n    workers: 2\n";
+        list.push_back(variant("connectivity_1", "    threads: 1\n", CONNECTIVITY));
+        list.back().sections = "connectivity:\n    radius: " + std::to_string(CONNECTIVITY_RADIUS) +
+                               "\n    file: connectivity.dat\n";
+        list.push_back(variant("connectivity_4", "    threads: 4\n", SAME));
+        list.back().sections = list[list.size() - 2].sections;
+        list.back().file = "connectivity.dat";
+        list.back().reference = "connectivity_1";
+        list.push_back(variant("mpi", "", EXACT));
+        list.back().mpi = true;
+        return list;
+    }
+
+    std::string absolute(const std::string& name)
+    {
+        if (!name.empty() && name[0] == '/')
+            return name;
+        char buffer[4096];
+        if (getcwd(buffer, sizeof(buffer)) == nullptr)
+            throw std::runtime_error("ERROR: cannot read the working directory");
+        return std::string(buffer) + "/" + name;
+    }
+
+    void makeDirectory(const std::string& name)
+    {
+        for (size_t pos = 1; pos <= name.size(); pos++)
+        {
+            if (pos == name.size() || name[pos] == '/')
+            {
+                const std::string part = name.substr(0, pos);
+                if (mkdir(part.c_str(), 0755) != 0 && errno != EEXIST)
+                    throw std::runtime_error("ERROR: cannot create the folder '" + part + "' (" + std::strerror(errno) + ")");
+            }
+        }
+    }
+
+    std::string readText(const std::string& name)
+    {
+        std::ifstream inFile(name);
+        if (!inFile)
+            throw std::runtime_error("ERROR: cannot read '" + name + "'");
+        std::stringstream text;
+        text << inFile.rdbuf();
+        return text.str();
+    }
+
+    std::vector<double> readValues(const std::string& name)
+    {
+        std::ifstream inFile(name);
+        if (!inFile)
+            throw std::runtime_error("ERROR: cannot read '" + name + "'");
+        std::vector<double> values;
+        double value;
+        while (inFile >> value)
+            values.push_back(value);
+        return values;
+    }
+
+    // Conductivity of each cell of the field (before the refinement)
+    std::vector<double> readConductivity(const Problem& problem)
+    {
+        std::ifstream inFile(problem.field);
+        if (!inFile)
+            throw std::runtime_error("ERROR: cannot read '" + problem.field + "'");
+        std::string line;
+        for (size_t i = 0; i < problem.skip; i++)
+            std::getline(inFile, line);
+        std::vector<double> values;
+        double value;
+        while (inFile >> value)
+            values.push_back(problem.log ? std::exp(value) : value);
+        if (values.size() != problem.nx * problem.ny * problem.nz)
+            throw std::runtime_error("ERROR: " + std::to_string(values.size()) + " values in '" + problem.field + "'");
+        return values;
+    }
+
+    // Run a command with its output in logName, wall time and peak memory of the process
+    Usage execute(const std::vector<std::string>& command, const std::string& logName)
+    {
+        std::vector<char*> argv;
+        for (auto& arg : command)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+
+        const auto start = std::chrono::steady_clock::now();
+        const pid_t pid = fork();
+        if (pid < 0)
+            throw std::runtime_error("ERROR: cannot start '" + command[0] + "'");
+        if (pid == 0)
+        {
+            const int log = open(logName.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+            if (log >= 0)
+            {
+                dup2(log, STDOUT_FILENO);
+                dup2(log, STDERR_FILENO);
+                close(log);
+            }
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+        int status = 0;
+        struct rusage usage;
+        if (wait4(pid, &status, 0, &usage) != pid)
+            throw std::runtime_error("ERROR: lost the process of '" + command[0] + "'");
+        Usage result;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#ifdef __APPLE__
+        result.peakKB = usage.ru_maxrss / 1024;
+#else
+        result.peakKB = usage.ru_maxrss;
+#endif
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            std::string log = readText(logName);
+            if (log.size() > 2000)
+                log = "..." + log.substr(log.size() - 2000);
+            throw std::runtime_error("ERROR: '" + command[0] + "' failed, see " + logName + "\n" + log);
+        }
+        return result;
+    }
+
+    // Same grid and inputs as the example, the outputs are its reference
+    Problem example(const Settings& settings, const std::string& name)
+    {
+        const std::string folder = settings.examples + "/" + name + "/";
+        lma::Input config(folder + "config.yaml");
+        Problem problem;
+        problem.nx = config.nx();
+        problem.ny = config.ny();
+        problem.nz = config.nz();
+        problem.dx = config.dx();
+        problem.dy = config.dy();
+        problem.dz = config.dz();
+        problem.refx = config.refx();
+        problem.refy = config.refy();
+        problem.refz = config.refz();
+        problem.connectivity = config.connectivity();
+        problem.field = lma::resolvePath(folder, config.field());
+        problem.skip = config.fieldSkip();
+        problem.log = config.fieldLog();
+        problem.source = "        file: " + lma::resolvePath(folder, config.source()) + "\n";
+        problem.target = "        file: " + lma::resolvePath(folder, config.target()) + "\n";
+        problem.res = lma::resolvePath(folder, config.outputRes());
+        problem.path = lma::resolvePath(folder, config.outputPath());
+        return problem;
+    }
+
+    // Random logK (normal, smoothed to form channels) from the left face to the right one
+    Problem synthetic(const Settings& settings, const std::string& name, const size_t nx, const size_t ny,
+                      const size_t nz, const size_t ref, const size_t connectivity)
+    {
+        Problem problem;
+        problem.nx = nx;
+        problem.ny = ny;
+        problem.nz = nz;
+        problem.dx = 1.0;
+        problem.dy = 0.5;
+        problem.dz = 2.0;
+        problem.refx = ref;
+        problem.refy = ref;
+        problem.refz = nz > 1 ? ref : 1;
+        problem.connectivity = connectivity;
+        problem.field = settings.work + "/" + name + "/field.dat";
+        problem.skip = 0;
+        problem.log = true;
+        problem.source = "        face: xmin\n";
+        problem.target = "        face: xmax\n";
+        problem.res = settings.work + "/" + name + "/dijkstra/hres.dat";
+        problem.path = settings.work + "/" + name + "/dijkstra/path.dat";
+
+        std::mt19937 generator(1234 + connectivity);
+        std::normal_distribution<double> normal(0., 1.5);
+        std::vector<double> logK(nx * ny * nz);
+        for (auto& value : logK)
+            value = normal(generator);
+        for (size_t pass = 0; pass < 2; pass++)
+        {
+            std::vector<double> smooth(logK.size());
+            for (size_t k = 0; k < nz; k++)
+            {
+                for (size_t j = 0; j < ny; j++)
+                {
+                    for (size_t i = 0; i < nx; i++)
+                    {
+                        double sum = 0.;
+                        size_t n = 0;
+                        for (size_t ii = (i > 0 ? i - 1 : i); ii <= std::min(i + 1, nx - 1); ii++)
+                        {
+                            for (size_t jj = (j > 0 ? j - 1 : j); jj <= std::min(j + 1, ny - 1); jj++)
+                            {
+                                sum += logK[ii + nx * (jj + ny * k)];
+                                n++;
+                            }
+                        }
+                        smooth[i + nx * (j + ny * k)] = 1.5 * sum / n;
+                    }
+                }
+            }
+            logK.swap(smooth);
+        }
+        makeDirectory(settings.work + "/" + name);
+        std::ofstream outFile(problem.field);
+        outFile << std::setprecision(9);
+        for (auto value : logK)
+            outFile << value << '\n';
+        if (!outFile)
+            throw std::runtime_error("ERROR: cannot write '" + problem.field + "'");
+        return problem;
+    }
+
+    void writeConfig(const std::string& folder, const Problem& problem, const Variant& variant,
+                     const std::string& field)
+    {
+        std::ofstream outFile(folder + "config.yaml");
+        outFile << "grid:\n"
+                << "    dimensions:\n"
+                << "        nx: " << problem.nx << "\n        ny: " << problem.ny << "\n        nz: " << problem.nz << "\n"
+                << "    cell size:\n"
+                << "        dx: " << problem.dx << "\n        dy: " << problem.dy << "\n        dz: " << problem.dz << "\n"
+                << "    refinement:\n"
+                << "        refx: " << problem.refx << "\n        refy: " << problem.refy << "\n        refz: " << problem.refz << "\n";
+        if (problem.connectivity > 0 && !variant.fullStencil)
+            outFile << "    connectivity: " << problem.connectivity << "\n";
+        outFile << "input:\n"
+                << "    field:\n"
+                << "        file: " << field << "\n"
+                << "        skip: " << (variant.tiled ? 0 : problem.skip) << "\n"
+                << "        log: " << (problem.log ? "true" : "false") << "\n";
+        if (variant.lazy)
+            outFile << "        lazy: true\n";
+        outFile << "    source:\n" << problem.source
+                << "    target:\n" << problem.target;
+        if (!variant.solver.empty())
+            outFile << "solver:\n" << variant.solver;
+        outFile << variant.sections
+                << "output:\n"
+                << "    resistance:\n"
+                << "        file: hres.dat\n"
+                << "        format: dense\n"
+                << "    path:\n"
+                << "        file: path.dat\n"
+                << variant.outputs;
+        if (!outFile)
+            throw std::runtime_error("ERROR: cannot write '" + folder + "config.yaml'");
+    }
+
+    // Largest relative difference of the resistance maps (infinite if a cell is reached by one map only)
+    double difference(const std::vector<double>& values, const std::vector<double>& expected)
+    {
+        if (values.size() != expected.size())
+            return std::numeric_limits<double>::infinity();
+        double maxError = 0.;
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            const bool isReached = values[i] < INF_THRESHOLD;
+            if (isReached != (expected[i] < INF_THRESHOLD))
+                return std::numeric_limits<double>::infinity();
+            if (isReached && values[i] != expected[i])
+                maxError = std::max(maxError, std::abs(values[i] - expected[i]) / std::max(std::abs(expected[i]), 1e-12));
+        }
+        return maxError;
+    }
+
+    double bestResistance(const std::vector<double>& values, const std::vector<size_t>& targets)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (auto id : targets)
+        {
+            if (id < values.size())
+                best = std::min(best, values[id]);
+        }
+        return best;
+    }
+
+    // Keep the first half of the batches of a checkpoint journal and a batch cut while writing,
+    // as left by a run killed halfway
+    void interruptJournal(const std::string& name)
+    {
+        const std::string journal = readText(name);
+        const size_t headerSize = 4 * sizeof(uint64_t);
+        const size_t recordSize = 4 * sizeof(uint64_t);
+        std::vector<size_t> batchEnds;
+        size_t offset = headerSize;
+        while (offset + sizeof(uint64_t) <= journal.size())
+        {
+            uint64_t n;
+            std::memcpy(&n, journal.data() + offset, sizeof(uint64_t));
+            offset += sizeof(uint64_t) + n * recordSize + sizeof(uint64_t);
+            if (offset > journal.size())
+                break;
+            batchEnds.push_back(offset);
+        }
+        if (batchEnds.size() < 4)
+            throw std::runtime_error("ERROR: " + std::to_string(batchEnds.size()) + " checkpoints in '" + name +
+                                     "', too few to interrupt the run");
+        const size_t end = batchEnds[batchEnds.size() / 2 - 1];
+        const size_t cut = std::min(batchEnds[batchEnds.size() / 2] - sizeof(uint64_t), end + sizeof(uint64_t) + recordSize);
+        std::ofstream outFile(name, std::ios::binary | std::ios::trunc);
+        outFile.write(journal.data(), cut);
+        if (!outFile)
+            throw std::runtime_error("ERROR: cannot write '" + name + "'");
+    }
+
+    // Empty if the outputs match the reference, the reason otherwise
+    std::string compare(const std::string& folder, const Problem& problem, const Variant& variant,
+                        const std::vector<size_t>& targets, const std::string& problemFolder)
+    {
+        std::ostringstream error;
+        error << std::setprecision(10);
+        // A realization of the ensemble and the run with attributes are compared as exact runs, the corridor
+        // run as a stopped one
+        const Check check = variant.check == ENSEMBLE || variant.check == ATTRIBUTES ? EXACT :
+                            variant.check == CORRIDOR ? BEST : variant.check;
+        auto compareRun = [&](const std::string& res, const std::string& path, const std::string& label)
+        {
+            const auto values = readValues(res);
+            const auto expected = readValues(problem.res);
+            const double maxError = difference(values, expected);
+            if ((check == EXACT || check == APPROXIMATE) && maxError > variant.tolerance)
+                error << label << "resistance map: relative difference " << maxError << " > " << variant.tolerance << ". ";
+            if (check != EXACT)
+            {
+                const double best = bestResistance(values, targets);
+                const double expectedBest = bestResistance(expected, targets);
+                const double tolerance = check == BEST ? 1e-9 : variant.tolerance;
+                if (!(std::abs(best - expectedBest) <= tolerance * expectedBest))
+                    error << label << "MHR " << best << " instead of " << expectedBest << ". ";
+            }
+            if ((check == EXACT || check == BEST) && readText(path) != readText(problem.path))
+                error << label << "least resistance path differs. ";
+        };
+
+        switch (variant.check)
+        {
+            case EXACT:
+            case APPROXIMATE:
+            case BEST:
+                compareRun(folder + "hres.dat", folder + "path.dat", "");
+                break;
+            case ENSEMBLE:
+                for (size_t i = 0; i < 2; i++)
+                {
+                    const std::string index = std::to_string(i);
+                    compareRun(folder + "hres_" + index + ".dat", folder + "path_" + index + ".dat",
+                               "realization " + index + ": ");
+                }
+                break;
+            case CORRIDOR:
+            {
+                compareRun(folder + "hres.dat", folder + "path.dat", "");
+                // The best path through a cell joins the reference map with the map from the targets
+                const auto forward = readValues(problem.res);
+                const auto backward = readValues(folder + "backward/hres.dat");
+                const auto mask = readValues(folder + "corridor.dat");
+                const auto slack = readValues(folder + "slack.dat");
+                if (forward.size() != backward.size() || mask.size() != forward.size() || slack.size() != forward.size())
+                {
+                    error << "corridor outputs of " << mask.size() << " and " << slack.size() << " cells instead of "
+                          << forward.size() << ". ";
+                    break;
+                }
+                const double best = bestResistance(forward, targets);
+                const double maxRes = (1. + CORRIDOR_TOLERANCE) * best;
+                for (size_t i = 0; i < forward.size(); i++)
+                {
+                    const bool isReached = forward[i] < INF_THRESHOLD && backward[i] < INF_THRESHOLD;
+                    const double total = forward[i] + backward[i];
+                    const double expectedSlack = isReached ? std::max(total - best, 0.) : slack[i];
+                    if (isReached != (slack[i] < INF_THRESHOLD) ||
+                        std::abs(slack[i] - expectedSlack) > OUTPUT_PRECISION * (isReached ? total : 0.))
+                    {
+                        error << "slack " << slack[i] << " of the cell " << i << " instead of " << expectedSlack << ". ";
+                        break;
+                    }
+                    // The cells at the threshold are decided by digits the outputs do not have
+                    const bool isInside = isReached && total <= maxRes;
+                    if ((mask[i] != 0.) != isInside && !(isReached && std::abs(total - maxRes) <= OUTPUT_PRECISION * maxRes))
+                    {
+                        error << "corridor mask " << mask[i] << " of the cell " << i << " with resistance " << total
+                              << " and threshold " << maxRes << ". ";
+                        break;
+                    }
+                }
+                break;
+            }
+            case PATHS:
+            {
+                // Number of paths through each cell (keyed by its center, as written in both files)
+                std::map<std::string, size_t> expected;
+                const size_t nTargets = readValues(folder + "targets.dat").size();
+                for (size_t i = 0; i < nTargets; i++)
+                {
+                    std::istringstream lines(readText(folder + "target_" + std::to_string(i) + "/path.dat"));
+                    std::string line;
+                    while (std::getline(lines, line))
+                        expected[line]++;
+                }
+                std::map<std::string, size_t> counts;
+                std::istringstream lines(readText(folder + "paths.dat"));
+                std::string line;
+                while (std::getline(lines, line))
+                {
+                    // x,y,z,id,count
+                    const size_t idPos = line.rfind(',', line.rfind(',') - 1);
+                    counts[line.substr(0, idPos)] += std::stoul(line.substr(line.rfind(',') + 1));
+                }
+                for (const auto& cell : expected)
+                {
+                    if (counts[cell.first] != cell.second)
+                    {
+                        error << counts[cell.first] << " paths through the cell " << cell.first << " instead of "
+                              << cell.second << ". ";
+                        break;
+                    }
+                }
+                if (expected.empty())
+                    error << "no path to the targets. ";
+                if (counts.size() != expected.size())
+                    error << counts.size() << " cells in the paths instead of " << expected.size() << ". ";
+                break;
+            }
+            case LABELS:
+            {
+                const auto sources = readValues(folder + "sources.dat");
+                std::vector<std::vector<double>> maps;
+                for (size_t i = 0; i < sources.size(); i++)
+                    maps.push_back(readValues(folder + "source_" + std::to_string(i) + "/hres.dat"));
+                const auto labels = readValues(folder + "labels.dat");
+                // Nearest source of a cell, the largest double if two sources are as near at the output precision
+                auto nearest = [&](const size_t cell, double& res) -> double
+                {
+                    size_t best = 0;
+                    for (size_t i = 1; i < maps.size(); i++)
+                    {
+                        if (maps[i][cell] < maps[best][cell])
+                            best = i;
+                    }
+                    res = maps[best][cell];
+                    if (res >= INF_THRESHOLD)
+                        return std::numeric_limits<double>::infinity();
+                    for (size_t i = 0; i < maps.size(); i++)
+                    {
+                        if (i != best && maps[i][cell] <= res + OUTPUT_PRECISION * std::max(res, 1e-12))
+                            return std::numeric_limits<double>::max();
+                    }
+                    return sources[best];
+                };
+                if (labels.size() != maps[0].size())
+                {
+                    error << "labels of " << labels.size() << " cells instead of " << maps[0].size() << ". ";
+                    break;
+                }
+                size_t nChecked = 0;
+                for (size_t cell = 0; cell < labels.size(); cell++)
+                {
+                    double res;
+                    const double expected = nearest(cell, res);
+                    if (expected == std::numeric_limits<double>::max())
+                        continue;
+                    if (std::isinf(expected) ? labels[cell] < INF_THRESHOLD : labels[cell] != expected)
+                    {
+                        error << "label " << labels[cell] << " of the cell " << cell << " instead of " << expected << ". ";
+                        break;
+                    }
+                    nChecked++;
+                }
+                if (nChecked == 0)
+                    error << "no label could be checked. ";
+
+                // "target source resistance" in the order of the targets
+                std::istringstream lines(readText(folder + "label_targets.dat"));
+                size_t row = 0;
+                size_t target;
+                double source, res;
+                while (lines >> target >> source >> res)
+                {
+                    double expectedRes;
+                    const double expected = row < targets.size() ? nearest(targets[row], expectedRes) : 0.;
+                    if (row >= targets.size() || target != targets[row] ||
+                        (expected != std::numeric_limits<double>::max() && source != expected) ||
+                        !(std::abs(res - expectedRes) <= OUTPUT_PRECISION * std::max(expectedRes, 1e-12)))
+                    {
+                        error << "label target row " << row << " '" << target << " " << source << " " << res
+                              << "' instead of the nearest source " << expected << " at " << expectedRes << ". ";
+                        break;
+                    }
+                    row++;
+                }
+                if (row != targets.size())
+                    error << row << " label target rows instead of " << targets.size() << ". ";
+                break;
+            }
+            case ATTRIBUTES:
+            {
+                compareRun(folder + "hres.dat", folder + "path.dat", "");
+                // Indices of the cells of the path (from the target to the source) on the refined grid
+                const double d[3] = {problem.dx / problem.refx, problem.dy / problem.refy, problem.dz / problem.refz};
+                const size_t n[3] = {problem.nx * problem.refx, problem.ny * problem.refy, problem.nz * problem.refz};
+                std::vector<std::vector<size_t>> path;
+                std::istringstream lines(readText(folder + "path.dat"));
+                std::string line;
+                while (std::getline(lines, line))
+                {
+                    std::replace(line.begin(), line.end(), ',', ' ');
+                    std::istringstream fields(line);
+                    std::vector<size_t> ids(3);
+                    for (size_t a = 0; a < 3; a++)
+                    {
+                        double center;
+                        fields >> center;
+                        ids[a] = static_cast<size_t>(center / d[a]);
+                    }
+                    path.push_back(ids);
+                }
+                const auto k = readConductivity(problem);
+                const auto length = readValues(folder + "length.dat");
+                const auto steps = readValues(folder + "steps.dat");
+                const auto minK = readValues(folder + "mink.dat");
+                const auto maxK = readValues(folder + "maxk.dat");
+                const size_t nCells = n[0] * n[1] * n[2];
+                if (path.empty() || length.size() != nCells || steps.size() != nCells || minK.size() != nCells ||
+                    maxK.size() != nCells)
+                {
+                    error << "attributes of " << length.size() << ", " << steps.size() << ", " << minK.size() << " and "
+                          << maxK.size() << " cells instead of " << nCells << ". ";
+                    break;
+                }
+
+                // The least resistance path of each cell of the path is the part from the cell to the source
+                double expectedLength = 0.;
+                double expectedMinK = std::numeric_limits<double>::max();
+                double expectedMaxK = 0.;
+                for (size_t p = path.size(); p-- > 0;)
+                {
+                    const auto& ids = path[p];
+                    if (p + 1 < path.size())
+                    {
+                        double squared = 0.;
+                        for (size_t a = 0; a < 3; a++)
+                        {
+                            const double delta = (static_cast<double>(ids[a]) - static_cast<double>(path[p + 1][a])) * d[a];
+                            squared += delta * delta;
+                        }
+                        expectedLength += std::sqrt(squared);
+                    }
+                    const double cellK = k[ids[0] / problem.refx + problem.nx * (ids[1] / problem.refy +
+                                           problem.ny * (ids[2] / problem.refz))];
+                    expectedMinK = std::min(expectedMinK, cellK);
+                    expectedMaxK = std::max(expectedMaxK, cellK);
+                    const size_t expectedSteps = path.size() - 1 - p;
+                    const size_t cell = ids[0] + n[0] * (ids[1] + n[1] * ids[2]);
+                    auto isClose = [](const double value, const double expected)
+                    {
+                        return std::abs(value - expected) <= OUTPUT_PRECISION * expected;
+                    };
+                    if (!isClose(length[cell], expectedLength) || steps[cell] != expectedSteps ||
+                        !isClose(minK[cell], expectedMinK) || !isClose(maxK[cell], expectedMaxK))
+                    {
+                        error << "attributes " << length[cell] << ", " << steps[cell] << ", " << minK[cell] << ", "
+                              << maxK[cell] << " of the cell " << cell << " instead of " << expectedLength << ", "
+                              << expectedSteps << ", " << expectedMinK << ", " << expectedMaxK << ". ";
+                        break;
+                    }
+                }
+                break;
+            }
+            case SAME:
+                if (readText(folder + variant.file) != readText(problemFolder + variant.reference + "/" + variant.file))
+                    error << variant.file << " differs from the one of " << variant.reference << ". ";
+                break;
+            case CONNECTIVITY:
+            {
+                const auto indicator = readValues(folder + "connectivity.dat");
+                for (size_t i = 0; i < SINGLE_RUNS; i++)
+                {
+                    // The source and the shell cells (targets) of the search of the cell alone
+                    const std::string cellFolder = folder + "cell_" + std::to_string(i) + "/";
+                    const size_t cell = static_cast<size_t>(readValues(cellFolder + "source.dat").at(0));
+                    const auto res = readValues(cellFolder + "hres.dat");
+                    double expected = std::numeric_limits<double>::max();
+                    for (auto shellCell : readValues(cellFolder + "target.dat"))
+                        expected = std::min(expected, res.at(static_cast<size_t>(shellCell)));
+                    const double value = indicator.at(cell);
+                    if (!(std::abs(value - expected) <= OUTPUT_PRECISION * expected))
+                    {
+                        error << "indicator " << value << " of the cell " << cell << " instead of " << expected << ". ";
+                        break;
+                    }
+                }
+                break;
+            }
+        }
+        if (variant.interrupted && readText(folder + "run.log").find("resuming from") == std::string::npos)
+            error << "the second run did not resume from the checkpoint. ";
+        return error.str();
+    }
+
+    // Previous runs of each problem/variant: seconds and peak memory
+    std::map<std::string, std::vector<Usage>> readHistory(const std::string& name)
+    {
+        std::map<std::string, std::vector<Usage>> history;
+        std::ifstream inFile(name);
+        std::string line;
+        while (std::getline(inFile, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::istringstream fields(line);
+            std::string time, key, status;
+            Usage usage;
+            if (fields >> time >> key >> usage.seconds >> usage.peakKB >> status && status == "OK")
+                history[key].push_back(usage);
+        }
+        return history;
+    }
+
+    double median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        const size_t n = values.size();
+        return n % 2 == 1 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+    }
+
+    // Empty if the run is not slower or larger than the median of the last runs
+    std::string regression(const std::vector<Usage>& previous, const Usage& usage)
+    {
+        const size_t nRecent = 5;
+        if (previous.size() < 3)
+            return "";
+        std::vector<double> seconds;
+        std::vector<double> peaks;
+        for (size_t i = previous.size() > nRecent ? previous.size() - nRecent : 0; i < previous.size(); i++)
+        {
+            seconds.push_back(previous[i].seconds);
+            peaks.push_back(static_cast<double>(previous[i].peakKB));
+        }
+        std::ostringstream message;
+        const double medianSeconds = median(seconds);
+        const double medianPeak = median(peaks);
+        // The absolute margins cover the noise of the timer and of the allocator on short runs
+        if (usage.seconds > 1.5 * medianSeconds + 0.1)
+            message << "time " << usage.seconds << "s (median " << medianSeconds << "s) ";
+        if (usage.peakKB > 1.2 * medianPeak + 4096)
+            message << "peak memory " << usage.peakKB << " KB (median " << medianPeak << " KB) ";
+        return message.str();
+    }
+
+    void copyFile(const std::string& from, const std::string& to)
+    {
+        std::ifstream inFile(from, std::ios::binary);
+        std::ofstream outFile(to, std::ios::binary);
+        outFile << inFile.rdbuf();
+        if (!inFile || !outFile)
+            throw std::runtime_error("ERROR: cannot copy '" + from + "' to '" + to + "'");
+    }
+
+    // A few cells along the sources (or targets) solved one at a time in folder/<name>_<i>/,
+    // the problem with these cells only (written to folder/<name>s.dat)
+    Problem solveEach(const Settings& settings, const std::string& folder, const Problem& problem,
+                      const Variant& variant, const std::string& field, const std::string& name,
+                      const std::vector<size_t>& ids)
+    {
+        std::ofstream listFile(folder + name + "s.dat");
+        const size_t n = std::min(SINGLE_RUNS, ids.size());
+        for (size_t i = 0; i < n; i++)
+        {
+            const std::string id = std::to_string(ids[i * ids.size() / n]);
+            listFile << id << '\n';
+            const std::string singleFolder = folder + name + "_" + std::to_string(i) + "/";
+            makeDirectory(singleFolder);
+            std::ofstream(singleFolder + name + ".dat") << id << '\n';
+            Problem single = problem;
+            (name == "source" ? single.source : single.target) = "        file: " + name + ".dat\n";
+            writeConfig(singleFolder, single, variant, field);
+            execute({settings.lazyMole, singleFolder}, folder + "run.log");
+        }
+        if (!listFile)
+            throw std::runtime_error("ERROR: cannot write '" + folder + name + "s.dat'");
+
+        Problem subset = problem;
+        (name == "source" ? subset.source : subset.target) = "        file: " + name + "s.dat\n";
+        return subset;
+    }
+
+    // Cells of the window of the cell (clipped by the domain) at radius cells from it along some axis
+    std::vector<size_t> windowShell(const mla::CartesianGrid& grid, const size_t cell, const size_t radius)
+    {
+        const auto ids = grid.splitId(cell);
+        const long r = static_cast<long>(radius);
+        const long rz = grid.nz() == 1 ? 0 : r;
+        const long n[3] = {static_cast<long>(grid.nx()), static_cast<long>(grid.ny()), static_cast<long>(grid.nz())};
+        std::vector<size_t> shell;
+        for (long dz = -rz; dz <= rz; dz++)
+        {
+            for (long dy = -r; dy <= r; dy++)
+            {
+                for (long dx = -r; dx <= r; dx++)
+                {
+                    const long x = static_cast<long>(ids[0]) + dx;
+                    const long y = static_cast<long>(ids[1]) + dy;
+                    const long z = static_cast<long>(ids[2]) + dz;
+                    const bool isShell = std::abs(dx) == r || std::abs(dy) == r || (rz > 0 && std::abs(dz) == r);
+                    if (isShell && x >= 0 && y >= 0 && z >= 0 && x < n[0] && y < n[1] && z < n[2])
+                        shell.push_back(grid.mergeIds(static_cast<size_t>(x), static_cast<size_t>(y), static_cast<size_t>(z)));
+                }
+            }
+        }
+        return shell;
+    }
+
+    int run(const Settings& settings, const std::string& name)
+    {
+        Problem problem;
+        if (name == "example1" || name == "example2" || name == "example3")
+            problem = example(settings, "Example" + name.substr(7));
+        else if (name == "grid2d_4")
+            problem = synthetic(settings, name, 300, 300, 1, 1, 4);
+        else if (name == "grid2d_8_refined")
+            problem = synthetic(settings, name, 120, 100, 1, 2, 8);
+        else if (name == "grid3d_6")
+            problem = synthetic(settings, name, 48, 48, 48, 1, 6);
+        else if (name == "grid3d_18")
+            problem = synthetic(settings, name, 40, 40, 40, 1, 18);
+        else if (name == "grid3d_26_refined")
+            problem = synthetic(settings, name, 24, 20, 20, 2, 26);
+        else
+            throw std::runtime_error("ERROR: unknown problem '" + name + "'");
+
+        const std::string problemFolder = settings.work + "/" + name + "/";
+        makeDirectory(problemFolder);
+
+        // Targets as lazyMole reads them, for the MHR of the partial resistance maps
+        const auto list = variants();
+        writeConfig(problemFolder, problem, list.front(), problem.field);
+        lma::Input config(problemFolder + "config.yaml");
+        mla::CartesianGrid grid(problem.nx, problem.ny, problem.nz, problem.dx, problem.dy, problem.dz,
+                                problem.refx, problem.refy, problem.refz);
+        const auto sources = lma::loadRegion(config, "source", problemFolder, &grid);
+        const auto targets = lma::loadRegion(config, "target", problemFolder, &grid);
+
+        auto history = readHistory(settings.history);
+        std::ofstream historyFile(settings.history, std::ios::app);
+        int nFailed = 0;
+        int nRegressions = 0;
+        for (const auto& variant : list)
+        {
+            const size_t fullConnectivity = problem.nz == 1 ? 8 : 26;
+            if (variant.fullStencil && problem.connectivity != 0 && problem.connectivity != fullConnectivity)
+            {
+                std::cout << std::setw(28) << std::left << name + "/" + variant.name << " skipped (not the full stencil)" << std::endl;
+                continue;
+            }
+            if (variant.mpi && settings.mpi.empty())
+            {
+                std::cout << std::setw(28) << std::left << name + "/" + variant.name << " skipped (no lazyMoleMPI)" << std::endl;
+                continue;
+            }
+            const std::string folder = problemFolder + variant.name + "/";
+            makeDirectory(folder);
+            for (const char* output : {"hres.dat", "path.dat", "checkpoint.dat", "result.cache", "run.log",
+                                       "field.lmt", "connectivity.dat", "ensemble.dat", "corridor.dat", "slack.dat",
+                                       "backward/hres.dat", "checkpoint.dat.new", "paths.dat",
+                                       "labels.dat", "label_targets.dat", "length.dat", "steps.dat", "mink.dat",
+                                       "maxk.dat"})
+            {
+                std::remove((folder + output).c_str());
+            }
+
+            std::string status = "OK";
+            std::string reason;
+            Usage usage = {0., 0};
+            try
+            {
+                std::string field = problem.field;
+                if (variant.tiled)
+                {
+                    writeConfig(folder, problem, list.front(), field);
+                    execute({settings.lazyMole, "--convert", "field.lmt", folder}, folder + "run.log");
+                    field = "field.lmt";
+                }
+                if (variant.check == ENSEMBLE)
+                {
+                    copyFile(problem.field, folder + "field_0.dat");
+                    copyFile(problem.field, folder + "field_1.dat");
+                }
+                if (variant.check == CORRIDOR)
+                {
+                    // Reference map from the targets: the resistance is symmetric
+                    Problem backward = problem;
+                    std::swap(backward.source, backward.target);
+                    makeDirectory(folder + "backward");
+                    writeConfig(folder + "backward/", backward, list.front(), field);
+                    execute({settings.lazyMole, folder + "backward/"}, folder + "run.log");
+                }
+                Problem variantProblem = problem;
+                if (variant.check == PATHS)
+                {
+                    Variant single = list.front();
+                    single.solver = "    stop:\n        targets: true\n";
+                    variantProblem = solveEach(settings, folder, problem, single, field, "target", targets);
+                }
+                else if (variant.check == LABELS)
+                {
+                    variantProblem = solveEach(settings, folder, problem, list.front(), field, "source", sources);
+                }
+                else if (variant.check == CONNECTIVITY)
+                {
+                    // A corner, a cell near a face, the center and the last cell: the search from the
+                    // cell to the shell of its window never needs the cells outside the window
+                    const size_t nx = grid.nx(), ny = grid.ny(), nz = grid.nz();
+                    const size_t cells[SINGLE_RUNS] = {0, grid.mergeIds(1, ny / 2, nz / 2),
+                                                       grid.mergeIds(nx / 2, ny / 2, nz / 2), grid.numberOfCells() - 1};
+                    Variant single = list.front();
+                    single.solver = "    stop:\n        targets: true\n";
+                    for (size_t i = 0; i < SINGLE_RUNS; i++)
+                    {
+                        const std::string cellFolder = folder + "cell_" + std::to_string(i) + "/";
+                        makeDirectory(cellFolder);
+                        std::ofstream(cellFolder + "source.dat") << cells[i] << '\n';
+                        std::ofstream targetFile(cellFolder + "target.dat");
+                        for (auto cell : windowShell(grid, cells[i], CONNECTIVITY_RADIUS))
+                            targetFile << cell << '\n';
+                        targetFile.close();
+                        Problem singleProblem = problem;
+                        singleProblem.source = "        file: source.dat\n";
+                        singleProblem.target = "        file: target.dat\n";
+                        writeConfig(cellFolder, singleProblem, single, field);
+                        execute({settings.lazyMole, cellFolder}, folder + "run.log");
+                    }
+                }
+                writeConfig(folder, variantProblem, variant, field);
+
+                std::vector<std::string> command;
+                if (variant.mpi)
+                {
+                    command = settings.mpiexec;
+                    command.insert(command.begin() + 1, {"-n", std::to_string(MPI_PROCESSES)});
+                    command.push_back(settings.mpi);
+                }
+                else
+                {
+                    command.push_back(settings.lazyMole);
+                }
+                command.push_back(folder);
+                for (size_t i = 0; i < variant.runs; i++)
+                {
+                    usage = execute(command, folder + "run.log");
+                    if (variant.interrupted && i == 0)
+                        interruptJournal(folder + "checkpoint.dat");
+                }
+                reason = compare(folder, problem, variant, targets, problemFolder);
+            }
+            catch (const std::exception& e)
+            {
+                reason = e.what();
+            }
+
+            const std::string key = name + "/" + variant.name;
+            std::string slower;
+            if (!reason.empty())
+            {
+                status = "FAILED";
+                nFailed++;
+            }
+            else
+            {
+                slower = regression(history[key], usage);
+                if (!slower.empty())
+                    nRegressions++;
+                historyFile << std::time(nullptr) << ' ' << key << ' ' << usage.seconds << ' '
+                            << usage.peakKB << ' ' << status << std::endl;
+            }
+            std::cout << std::setw(28) << std::left << key << ' ' << std::setw(6) << status << std::right
+                      << std::fixed << std::setprecision(3) << std::setw(9) << usage.seconds << "s "
+                      << std::setw(9) << usage.peakKB << " KB" << std::defaultfloat << std::endl;
+            if (!reason.empty())
+                std::cerr << "ERROR: " << key << ": " << reason << std::endl;
+            if (!slower.empty())
+                std::cerr << "WARNING: " << key << ": performance regression, " << slower << std::endl;
+        }
+        return nFailed + (settings.strict ? nRegressions : 0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        Settings settings;
+        std::string problem;
+        std::vector<std::string> mpiFlags;
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--lazymole" && hasValue)
+                settings.lazyMole = absolute(argv[++i]);
+            else if (arg == "--examples" && hasValue)
+                settings.examples = absolute(argv[++i]);
+            else if (arg == "--work" && hasValue)
+                settings.work = absolute(argv[++i]);
+            else if (arg == "--history" && hasValue)
+                settings.history = absolute(argv[++i]);
+            else if (arg == "--mpi" && hasValue)
+                settings.mpi = absolute(argv[++i]);
+            else if (arg == "--mpiexec" && hasValue)
+                settings.mpiexec.insert(settings.mpiexec.begin(), argv[++i]);
+            else if (arg == "--mpiflag" && hasValue)
+                mpiFlags.push_back(argv[++i]);
+            else if (arg == "--strict")
+                settings.strict = true;
+            else if (problem.empty() && arg[0] != '-')
+                problem = arg;
+            else
+                throw std::runtime_error("ERROR: unknown argument '" + arg + "'");
+        }
+        if (problem.empty() || settings.lazyMole.empty() || settings.examples.empty() || settings.work.empty() ||
+            settings.history.empty() || (!settings.mpi.empty() && settings.mpiexec.empty()))
+        {
+            throw std::runtime_error("ERROR: use 'regression --lazymole BIN --examples DIR --work DIR --history FILE "
+                                     "[--mpi BIN --mpiexec EXE [--mpiflag FLAG]...] [--strict] problem'");
+        }
+        settings.mpiexec.insert(settings.mpiexec.end(), mpiFlags.begin(), mpiFlags.end());
+        makeDirectory(settings.work);
+        return run(settings, problem) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
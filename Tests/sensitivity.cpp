@@ -0,0 +1,148 @@
+/**
+* @file sensitivity.cpp
+* @brief Test of LazyMole::sensitivity against finite differences of the conductivity
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <CartesianGrid.h>
+#include <CellRegion.h>
+#include <CellField.h>
+#include <LazyMole.h>
+
+/**
+ * On small random fields (2D and 3D, each stencil) the derivative of the MHR of the best target,
+ * and of the sum of the resistances of all the targets, with respect to the conductivity of each
+ * cell is compared with the central difference of a relative perturbation of that conductivity.
+ *
+ * usage: sensitivity
+ */
+
+namespace
+{
+    // Relative perturbation of the conductivity and tolerance on the derivative
+    const double STEP = 1e-5;
+    const double TOLERANCE = 1e-6;
+
+    int nFailed = 0;
+
+    // Resistance of the best target (or the sum over the targets) and the targets used
+    double objective(mla::LazyMole& lazyMole, const std::vector<size_t>& sources, const std::vector<size_t>& targets,
+                     const bool isBest, std::vector<size_t>& cells)
+    {
+        lazyMole.reset(sources);
+        const auto smallestRes = lazyMole.run();
+        double value = isBest ? std::numeric_limits<double>::max() : 0.;
+        cells.clear();
+        for (auto cell : targets)
+        {
+            const double res = smallestRes->getFromCell(cell);
+            if (!isBest)
+            {
+                value += res;
+                cells.push_back(cell);
+            }
+            else if (res < value)
+            {
+                value = res;
+                cells.assign(1, cell);
+            }
+        }
+        return value;
+    }
+
+    void test(const std::string& name, const size_t nx, const size_t ny, const size_t nz, const mla::Stencil stencil)
+    {
+        mla::CartesianGrid grid(nx, ny, nz, 1.0, 0.5, 2.0);
+        grid.setStencil(stencil);
+        mla::CellField<double> field(&grid, 0.);
+        std::mt19937 generator(4321 + nz);
+        std::normal_distribution<double> normal(0., 1.);
+        for (size_t cell = 0; cell < grid.numberOfCells(); cell++)
+            field.set(cell, std::exp(normal(generator)));
+
+        mla::CellRegion sourceRegion(&grid);
+        sourceRegion.addFace("xmin");
+        mla::CellRegion targetRegion(&grid);
+        targetRegion.addFace("xmax");
+        const auto sources = sourceRegion.cells();
+        const auto targets = targetRegion.cells();
+
+        mla::LazyMole lazyMole(&grid, field, sources);
+        for (const bool isBest : {true, false})
+        {
+            std::vector<size_t> cells;
+            objective(lazyMole, sources, targets, isBest, cells);
+            const auto gradient = lazyMole.sensitivity(cells);
+
+            std::vector<double> differences(grid.numberOfCells());
+            double scale = 0.;
+            std::vector<size_t> unused;
+            for (size_t cell = 0; cell < grid.numberOfCells(); cell++)
+            {
+                const double k = field.getFromCell(cell);
+                lazyMole.setConductivity(cell, k * (1. + STEP));
+                const double upper = objective(lazyMole, sources, targets, isBest, unused);
+                lazyMole.setConductivity(cell, k * (1. - STEP));
+                const double lower = objective(lazyMole, sources, targets, isBest, unused);
+                lazyMole.setConductivity(cell, k);
+                differences[cell] = (upper - lower) / (2. * STEP * k);
+                scale = std::max(scale, std::abs(differences[cell]));
+            }
+
+            size_t nOnPaths = 0;
+            size_t nWrong = 0;
+            for (size_t cell = 0; cell < grid.numberOfCells(); cell++)
+            {
+                const double value = gradient.getFromCell(cell);
+                nOnPaths += value != 0. ? 1 : 0;
+                if (!(std::abs(value - differences[cell]) <= TOLERANCE * scale))
+                {
+                    if (nWrong++ == 0)
+                    {
+                        std::cerr << "ERROR: " << name << (isBest ? " (best target)" : " (all targets)")
+                                  << ": derivative " << value << " of the cell " << cell
+                                  << " instead of " << differences[cell] << std::endl;
+                    }
+                }
+            }
+            if (nOnPaths == 0)
+                std::cerr << "ERROR: " << name << ": no cell on the least resistance paths" << std::endl;
+            nFailed += nWrong > 0 || nOnPaths == 0 ? 1 : 0;
+        }
+    }
+}
+
+int main()
+{
+    test("2D face stencil", 12, 10, 1, mla::FACE);
+    test("2D full stencil", 12, 10, 1, mla::FULL);
+    test("3D face stencil", 6, 5, 4, mla::FACE);
+    test("3D edge stencil", 6, 5, 4, mla::EDGE);
+    test("3D full stencil", 6, 5, 4, mla::FULL);
+    std::cout << (nFailed == 0 ? "OK" : "FAILED") << std::endl;
+    return nFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,293 @@
+/**
+* @file server.cpp
+* @brief Test of the line protocol of 'lazyMole --serve' against the outputs of lazyMole
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+
+/**
+ * The sources and targets of Example1 are sent to 'lazyMole --serve' as solve and path queries,
+ * together with info, invalid queries and quit. The answers are compared with the reference
+ * outputs of lazyMole. The queries are repeated after a short one on the same solver, whose
+ * reset restores only the cells visited by the previous query: the answers must not change.
+ * A second server has a max resistance below the MHR, and a third one the refused bucket queue. The configuration of the server names source and target files that do
+ * not exist: the server takes them from the queries only.
+ *
+ * usage: server LAZYMOLE EXAMPLES_DIR WORK_DIR
+ */
+
+namespace
+{
+    // Outputs written with the default precision (6 significant digits)
+    const double OUTPUT_PRECISION = 1e-5;
+
+    const size_t NX = 200, NY = 100;
+
+    int nFailed = 0;
+
+    void check(const bool condition, const std::string& message)
+    {
+        if (!condition)
+        {
+            std::cerr << "ERROR: " << message << std::endl;
+            nFailed++;
+        }
+    }
+
+    std::string readText(const std::string& name)
+    {
+        std::ifstream inFile(name);
+        if (!inFile)
+            throw std::runtime_error("ERROR: cannot read '" + name + "'");
+        std::stringstream text;
+        text << inFile.rdbuf();
+        return text.str();
+    }
+
+    std::vector<double> readValues(const std::string& name)
+    {
+        std::string text = readText(name);
+        std::replace(text.begin(), text.end(), ',', ' ');
+        std::istringstream inStream(text);
+        std::vector<double> values;
+        double value;
+        while (inStream >> value)
+            values.push_back(value);
+        return values;
+    }
+
+    // Run the server on the requests, its answers (one per line)
+    std::vector<std::string> serve(const std::string& lazyMole, const std::string& folder, const std::string& requests)
+    {
+        int inPipe[2], outPipe[2];
+        if (pipe(inPipe) != 0 || pipe(outPipe) != 0)
+            throw std::runtime_error(std::string("ERROR: cannot create the pipes (") + std::strerror(errno) + ")");
+        const pid_t pid = fork();
+        if (pid < 0)
+            throw std::runtime_error(std::string("ERROR: cannot start lazyMole (") + std::strerror(errno) + ")");
+        if (pid == 0)
+        {
+            dup2(inPipe[0], STDIN_FILENO);
+            dup2(outPipe[1], STDOUT_FILENO);
+            const int log = open((folder + "server.log").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (log >= 0)
+                dup2(log, STDERR_FILENO);
+            close(inPipe[0]);
+            close(inPipe[1]);
+            close(outPipe[0]);
+            close(outPipe[1]);
+            execl(lazyMole.c_str(), lazyMole.c_str(), "--serve", "--workspaces", "2", folder.c_str(),
+                  static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        close(inPipe[0]);
+        close(outPipe[1]);
+        size_t written = 0;
+        while (written < requests.size())
+        {
+            const ssize_t n = write(inPipe[1], requests.data() + written, requests.size() - written);
+            if (n <= 0)
+                break;
+            written += static_cast<size_t>(n);
+        }
+        close(inPipe[1]);
+
+        std::string output;
+        char chunk[4096];
+        ssize_t n;
+        while ((n = read(outPipe[0], chunk, sizeof(chunk))) > 0)
+            output.append(chunk, static_cast<size_t>(n));
+        close(outPipe[0]);
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            throw std::runtime_error("ERROR: the server failed, see '" + folder + "server.log'");
+
+        std::vector<std::string> answers;
+        std::istringstream lines(output);
+        std::string line;
+        while (std::getline(lines, line))
+            answers.push_back(line);
+        return answers;
+    }
+
+    bool startsWith(const std::string& text, const std::string& prefix)
+    {
+        return text.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    // Example1 (200x100 cells, full stencil) with source and target files that do not exist
+    void writeConfig(const std::string& folder, const std::string& example, const std::string& solver)
+    {
+        std::ofstream configFile(folder + "config.yaml");
+        configFile << "grid:\n    dimensions:\n        nx: " << NX << "\n        ny: " << NY << "\n        nz: 1\n"
+                   << "    cell size:\n        dx: 1.0\n        dy: 1.0\n        dz: 1.0\n"
+                   << "    refinement:\n        refx: 1\n        refy: 1\n        refz: 1\n"
+                   << "input:\n    field:\n        file: " << example << "field.dat\n        skip: 0\n        log: true\n"
+                   << "    source:\n        file: missing_sources.dat\n"
+                   << "    target:\n        file: missing_targets.dat\n"
+                   << "output:\n    resistance:\n        file: hres.dat\n        format: dense\n"
+                   << "    path:\n        file: path.dat\n"
+                   << solver;
+        configFile.close();
+        if (!configFile)
+            throw std::runtime_error("ERROR: cannot write '" + folder + "config.yaml'");
+    }
+
+    std::string join(const std::vector<double>& ids)
+    {
+        std::ostringstream out;
+        for (size_t i = 0; i < ids.size(); i++)
+            out << (i > 0 ? " " : "") << static_cast<size_t>(ids[i]);
+        return out.str();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc != 4)
+            throw std::runtime_error("ERROR: usage: server LAZYMOLE EXAMPLES_DIR WORK_DIR");
+        const std::string lazyMole = argv[1];
+        const std::string example = std::string(argv[2]) + "/Example1/";
+        const std::string folder = std::string(argv[3]) + "/";
+        if (mkdir(folder.c_str(), 0755) != 0 && errno != EEXIST)
+            throw std::runtime_error("ERROR: cannot create the folder '" + folder + "' (" + std::strerror(errno) + ")");
+
+        const size_t nCells = NX * NY;
+        writeConfig(folder, example, "");
+
+        const auto sources = readValues(example + "source1.dat");
+        const auto targets = readValues(example + "target1.dat");
+        const auto res = readValues(example + "hres1.dat");
+        const auto path = readValues(example + "path1.dat");
+        double expectedMhr = std::numeric_limits<double>::max();
+        size_t expectedTarget = nCells;
+        for (auto id : targets)
+        {
+            if (res.at(static_cast<size_t>(id)) < expectedMhr)
+            {
+                expectedMhr = res[static_cast<size_t>(id)];
+                expectedTarget = static_cast<size_t>(id);
+            }
+        }
+        const size_t pathLength = path.size() / 3;
+
+        const std::string query = join(sources) + " ; " + join(targets);
+        const std::string shortQuery = "0 ; " + std::to_string(NX + 1);
+        auto answers = serve(lazyMole, folder, "info\nsolve " + query + "\npath " + query + "\n"
+                                   "solve 0 ; " + std::to_string(nCells) + "\nsolve 0\nmove 0 ; 1\n"
+                                   "path " + shortQuery + "\npath " + query + "\npath " + shortQuery + "\n"
+                                   "quit\ninfo\n");
+        check(answers.size() == 9, std::to_string(answers.size()) + " answers instead of 9 (none after quit)");
+        answers.resize(9);
+
+        check(answers[0] == "ok " + std::to_string(nCells), "info: '" + answers[0] + "'");
+
+        for (size_t i = 1; i <= 2; i++)
+        {
+            std::istringstream answer(answers[i]);
+            std::string status;
+            double mhr = 0.;
+            size_t target = 0, length = 0;
+            answer >> status >> mhr >> target >> length;
+            check(status == "ok" && std::abs(mhr - expectedMhr) <= OUTPUT_PRECISION * expectedMhr &&
+                  target == expectedTarget && length == pathLength,
+                  "'" + answers[i].substr(0, 80) + "' instead of the MHR " + std::to_string(expectedMhr) +
+                  " at the target " + std::to_string(expectedTarget) + " with a path of " +
+                  std::to_string(pathLength) + " cells");
+            if (i == 2)
+            {
+                // Cell ids of the path from the target back to the source, as the centers of path1.dat
+                bool isSame = true;
+                for (size_t j = 0; j < length && j < pathLength; j++)
+                {
+                    size_t cell = 0;
+                    answer >> cell;
+                    isSame = isSame && cell % NX + 0.5 == path[3 * j] && cell / NX + 0.5 == path[3 * j + 1];
+                }
+                check(isSame && answer, "path: the cells differ from the least resistance path of lazyMole");
+            }
+        }
+
+        check(startsWith(answers[3], "error invalid cell id "), "id outside the grid: '" + answers[3] + "'");
+        check(startsWith(answers[4], "error sources and targets are required"), "no targets: '" + answers[4] + "'");
+        check(answers[5] == "error unknown command 'move'", "unknown command: '" + answers[5] + "'");
+
+        // The same solver answers a short query between the full ones
+        check(startsWith(answers[6], "ok ") && answers[6] != answers[2],
+              "short query: '" + answers[6] + "'");
+        check(answers[7] == answers[2], "path query after a short one: '" + answers[7].substr(0, 80) +
+              "' instead of '" + answers[2].substr(0, 80) + "'");
+        check(answers[8] == answers[6], "short query after a full one: '" + answers[8] + "' instead of '" +
+              answers[6] + "'");
+
+        // The max resistance of the configuration applies to the queries, the bucket queue is refused
+        const std::string shortAnswer = answers[6];
+        const std::string limitedFolder = folder + "limited/";
+        if (mkdir(limitedFolder.c_str(), 0755) != 0 && errno != EEXIST)
+            throw std::runtime_error("ERROR: cannot create the folder '" + limitedFolder + "' (" +
+                                     std::strerror(errno) + ")");
+        writeConfig(limitedFolder, example, "solver:\n    stop:\n        max resistance: " +
+                    std::to_string(0.5 * expectedMhr) + "\n");
+        answers = serve(lazyMole, limitedFolder, "solve " + query + "\npath " + shortQuery + "\n");
+        const std::string unreached = "ok inf " + std::to_string(nCells) + " 0";
+        check(answers.size() == 2 && answers[0] == unreached && answers[1] == shortAnswer,
+              "max resistance: '" + (answers.empty() ? "" : answers[0]) + "' instead of '" + unreached +
+              "' and the short query unchanged");
+
+        writeConfig(limitedFolder, example, "solver:\n    queue: bucket\n    epsilon: 0.01\n");
+        bool isRefused = false;
+        try
+        {
+            serve(lazyMole, limitedFolder, "info\n");
+        }
+        catch (const std::runtime_error&)
+        {
+            isRefused = readText(limitedFolder + "server.log").find("the server answers with the heap queue") !=
+                        std::string::npos;
+        }
+        check(isRefused, "bucket queue: the server did not refuse it");
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << (nFailed == 0 ? "OK" : "FAILED") << std::endl;
+    return nFailed == 0 ? 0 : 1;
+}
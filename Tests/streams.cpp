@@ -0,0 +1,298 @@
+/**
+* @file streams.cpp
+* @brief Test of the standard input/output and of the shared memory segments of lazyMole
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+/**
+ * Example1 is solved by lazyMole with the field read from the standard input, with the
+ * resistance map written to the standard output, and with both in POSIX shared memory
+ * segments. Each resistance map is compared with the reference output of the example.
+ * A field in a segment that does not exist must be an error.
+ *
+ * usage: streams LAZYMOLE EXAMPLES_DIR WORK_DIR
+ */
+
+namespace
+{
+    // Outputs written with the default precision (6 significant digits)
+    const double OUTPUT_PRECISION = 1e-5;
+
+    const size_t NX = 200, NY = 100;
+
+    int nFailed = 0;
+
+    void check(const bool condition, const std::string& message)
+    {
+        if (!condition)
+        {
+            std::cerr << "ERROR: " << message << std::endl;
+            nFailed++;
+        }
+    }
+
+    std::string readText(const std::string& name)
+    {
+        std::ifstream inFile(name);
+        if (!inFile)
+            throw std::runtime_error("ERROR: cannot read '" + name + "'");
+        std::stringstream text;
+        text << inFile.rdbuf();
+        return text.str();
+    }
+
+    std::vector<double> parseValues(const std::string& text)
+    {
+        std::istringstream inStream(text);
+        std::vector<double> values;
+        double value;
+        while (inStream >> value)
+            values.push_back(value);
+        return values;
+    }
+
+    // Example1 with the given field and resistance map, in its own folder
+    std::string prepare(const std::string& work, const std::string& name, const std::string& example,
+                        const std::string& field, const std::string& res)
+    {
+        const std::string folder = work + name + "/";
+        if (mkdir(folder.c_str(), 0755) != 0 && errno != EEXIST)
+            throw std::runtime_error("ERROR: cannot create the folder '" + folder + "' (" + std::strerror(errno) + ")");
+        std::remove((folder + "hres.dat").c_str());
+        std::remove((folder + "path.dat").c_str());
+        std::ofstream configFile(folder + "config.yaml");
+        configFile << "grid:\n    dimensions:\n        nx: " << NX << "\n        ny: " << NY << "\n        nz: 1\n"
+                   << "    cell size:\n        dx: 1.0\n        dy: 1.0\n        dz: 1.0\n"
+                   << "    refinement:\n        refx: 1\n        refy: 1\n        refz: 1\n"
+                   << "input:\n    field:\n        file: \"" << field << "\"\n        skip: 0\n        log: true\n"
+                   << "    source:\n        file: " << example << "source1.dat\n"
+                   << "    target:\n        file: " << example << "target1.dat\n"
+                   << "output:\n    resistance:\n        file: \"" << res << "\"\n        format: dense\n"
+                   << "    path:\n        file: path.dat\n";
+        configFile.close();
+        if (!configFile)
+            throw std::runtime_error("ERROR: cannot write '" + folder + "config.yaml'");
+        return folder;
+    }
+
+    // Run lazyMole on the folder with input on its standard input, true if it succeeded. Its
+    // standard output is returned in output, its standard error is written to folder/run.log.
+    bool run(const std::string& lazyMole, const std::string& folder, const std::string& input, std::string& output)
+    {
+        int inPipe[2], outPipe[2];
+        if (pipe(inPipe) != 0 || pipe(outPipe) != 0)
+            throw std::runtime_error(std::string("ERROR: cannot create the pipes (") + std::strerror(errno) + ")");
+        const pid_t pid = fork();
+        if (pid < 0)
+            throw std::runtime_error(std::string("ERROR: cannot start lazyMole (") + std::strerror(errno) + ")");
+        if (pid == 0)
+        {
+            dup2(inPipe[0], STDIN_FILENO);
+            dup2(outPipe[1], STDOUT_FILENO);
+            const int log = open((folder + "run.log").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (log >= 0)
+                dup2(log, STDERR_FILENO);
+            close(inPipe[0]);
+            close(inPipe[1]);
+            close(outPipe[0]);
+            close(outPipe[1]);
+            execl(lazyMole.c_str(), lazyMole.c_str(), folder.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        close(inPipe[0]);
+        close(outPipe[1]);
+        size_t written = 0;
+        while (written < input.size())
+        {
+            const ssize_t n = write(inPipe[1], input.data() + written, input.size() - written);
+            if (n <= 0)
+                break;
+            written += static_cast<size_t>(n);
+        }
+        close(inPipe[1]);
+
+        output.clear();
+        char chunk[4096];
+        ssize_t n;
+        while ((n = read(outPipe[0], chunk, sizeof(chunk))) > 0)
+            output.append(chunk, static_cast<size_t>(n));
+        close(outPipe[0]);
+        int status = 0;
+        waitpid(pid, &status, 0);
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    // Number of resistances that differ from the reference (all of them if the sizes differ)
+    size_t countDifferent(const std::vector<double>& values, const std::vector<double>& expected)
+    {
+        if (values.size() != expected.size())
+            return expected.size();
+        size_t nDifferent = 0;
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            if (!(std::abs(values[i] - expected[i]) <= OUTPUT_PRECISION * std::max(std::abs(expected[i]), 1e-12)))
+                nDifferent++;
+        }
+        return nDifferent;
+    }
+
+    // Create the segment with the values (name without the "shm:" prefix)
+    void writeSegment(const std::string& name, const std::vector<double>& values)
+    {
+        const size_t size = values.size() * sizeof(double);
+        const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0)
+            throw std::runtime_error("ERROR: cannot create the shared memory segment " + name);
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            throw std::runtime_error("ERROR: cannot map the shared memory segment " + name);
+        std::memcpy(data, values.data(), size);
+        munmap(data, size);
+    }
+
+    // Values of an existing segment, empty if it does not exist
+    std::vector<double> readSegment(const std::string& name)
+    {
+        const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+            return {};
+        struct stat info;
+        std::vector<double> values;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            const size_t size = static_cast<size_t>(info.st_size);
+            void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                values.resize(size / sizeof(double));
+                std::memcpy(values.data(), data, values.size() * sizeof(double));
+                munmap(data, size);
+            }
+        }
+        close(fd);
+        return values;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc != 4)
+            throw std::runtime_error("ERROR: usage: streams LAZYMOLE EXAMPLES_DIR WORK_DIR");
+        // A lazyMole that fails while reading its input must not stop the test
+        std::signal(SIGPIPE, SIG_IGN);
+        const std::string lazyMole = argv[1];
+        const std::string example = std::string(argv[2]) + "/Example1/";
+        const std::string work = std::string(argv[3]) + "/";
+        if (mkdir(work.c_str(), 0755) != 0 && errno != EEXIST)
+            throw std::runtime_error("ERROR: cannot create the folder '" + work + "' (" + std::strerror(errno) + ")");
+
+        const std::string fieldText = readText(example + "field.dat");
+        const auto expected = parseValues(readText(example + "hres1.dat"));
+        const std::string expectedPath = readText(example + "path1.dat");
+        std::string output;
+
+        // Field from the standard input
+        std::string folder = prepare(work, "stdin", example, "-", "hres.dat");
+        if (run(lazyMole, folder, fieldText, output))
+        {
+            const size_t nDifferent = countDifferent(parseValues(readText(folder + "hres.dat")), expected);
+            check(nDifferent == 0, "field from the standard input: " + std::to_string(nDifferent) +
+                  " resistances differ from the reference");
+            check(readText(folder + "path.dat") == expectedPath,
+                  "field from the standard input: the least resistance path differs from the reference");
+        }
+        else
+        {
+            check(false, "field from the standard input: lazyMole failed, see '" + folder + "run.log'");
+        }
+
+        // Resistance map to the standard output, the messages go to the standard error
+        folder = prepare(work, "stdout", example, example + "field.dat", "-");
+        if (run(lazyMole, folder, "", output))
+        {
+            const size_t nDifferent = countDifferent(parseValues(output), expected);
+            check(nDifferent == 0, "resistance map to the standard output: " + std::to_string(nDifferent) +
+                  " resistances differ from the reference");
+            check(readText(folder + "run.log").find("Exporting resistance map") != std::string::npos,
+                  "resistance map to the standard output: the messages are not on the standard error");
+        }
+        else
+        {
+            check(false, "resistance map to the standard output: lazyMole failed, see '" + folder + "run.log'");
+        }
+
+        // Field and resistance map in shared memory segments (logK values, one double per cell)
+        const std::string segment = "/lazymole_streams_" + std::to_string(getpid());
+        writeSegment(segment + "_field", parseValues(fieldText));
+        shm_unlink((segment + "_res").c_str());
+        folder = prepare(work, "shm", example, "shm:" + segment + "_field", "shm:" + segment + "_res");
+        const bool isShmRun = run(lazyMole, folder, "", output);
+        const auto values = readSegment(segment + "_res");
+        shm_unlink((segment + "_field").c_str());
+        shm_unlink((segment + "_res").c_str());
+        if (isShmRun)
+        {
+            const size_t nDifferent = countDifferent(values, expected);
+            check(nDifferent == 0, "shared memory: " + std::to_string(values.size()) + " resistances in the segment, " +
+                  std::to_string(nDifferent) + " differ from the reference");
+            check(readText(folder + "path.dat") == expectedPath,
+                  "shared memory: the least resistance path differs from the reference");
+        }
+        else
+        {
+            check(false, "shared memory: lazyMole failed, see '" + folder + "run.log'");
+        }
+
+        // A segment that does not exist
+        folder = prepare(work, "shm_missing", example, "shm:" + segment + "_missing", "hres.dat");
+        const bool isMissingRun = run(lazyMole, folder, "", output);
+        check(!isMissingRun && readText(folder + "run.log").find("cannot open the shared memory segment " + segment +
+                                                                 "_missing") != std::string::npos,
+              "missing shared memory segment: lazyMole did not fail with the name of the segment");
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << (nFailed == 0 ? "OK" : "FAILED") << std::endl;
+    return nFailed == 0 ? 0 : 1;
+}
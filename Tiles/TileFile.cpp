@@ -0,0 +1,509 @@
+/**
+* @file TileFile.cpp
+* @brief Container of a conductivity field split in fixed size 3D tiles,
+*        each one compressed independently, with an index of the tiles
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TileFile.h"
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+
+#ifdef LMA_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef LMA_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef LMA_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace lma {
+
+    bool TileFile::isAvailable(const Codec codec)
+    {
+        switch (codec)
+        {
+            case RAW:
+                return true;
+#ifdef LMA_HAVE_ZLIB
+            case ZLIB:
+                return true;
+#endif
+#ifdef LMA_HAVE_LZ4
+            case LZ4:
+                return true;
+#endif
+#ifdef LMA_HAVE_ZSTD
+            case ZSTD:
+                return true;
+#endif
+            default:
+                return false;
+        }
+    }
+
+    TileFile::Codec TileFile::bestCodec()
+    {
+        for (auto codec : {ZSTD, LZ4, ZLIB})
+        {
+            if (isAvailable(codec))
+                return codec;
+        }
+        return RAW;
+    }
+
+    TileFile::Codec TileFile::codecFromName(const std::string& name)
+    {
+        for (auto codec : {RAW, ZLIB, LZ4, ZSTD})
+        {
+            if (name == codecName(codec))
+            {
+                if (!isAvailable(codec))
+                {
+                    throw std::runtime_error("ERROR: the codec '" + name + "' is not available in this build");
+                }
+                return codec;
+            }
+        }
+        throw std::runtime_error("ERROR: unknown codec '" + name + "' (use 'raw', 'zlib', 'lz4' or 'zstd')");
+    }
+
+    std::string TileFile::codecName(const Codec codec)
+    {
+        switch (codec)
+        {
+            case RAW:
+                return "raw";
+            case ZLIB:
+                return "zlib";
+            case LZ4:
+                return "lz4";
+            case ZSTD:
+                return "zstd";
+        }
+        return "unknown";
+    }
+
+    // The i-th bytes of the doubles are stored together: the exponent bytes of similar
+    // values then form long runs which compress much better
+    static void shuffle(const double* values, const size_t n, char* out)
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+        for (size_t b = 0; b < sizeof(double); b++)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                out[b * n + i] = bytes[i * sizeof(double) + b];
+            }
+        }
+    }
+
+    static void unshuffle(const char* in, const size_t n, double* values)
+    {
+        unsigned char* bytes = reinterpret_cast<unsigned char*>(values);
+        for (size_t b = 0; b < sizeof(double); b++)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                bytes[i * sizeof(double) + b] = in[b * n + i];
+            }
+        }
+    }
+
+    void TileFile::compress(const Codec codec, const std::vector<double>& values, std::vector<char>& out)
+    {
+        const size_t size = values.size() * sizeof(double);
+        std::vector<char> shuffled(size);
+        shuffle(values.data(), values.size(), shuffled.data());
+
+        switch (codec)
+        {
+#ifdef LMA_HAVE_ZLIB
+            case ZLIB:
+            {
+                uLongf outSize = compressBound(static_cast<uLong>(size));
+                out.resize(outSize);
+                if (compress2(reinterpret_cast<Bytef*>(out.data()), &outSize,
+                              reinterpret_cast<const Bytef*>(shuffled.data()), static_cast<uLong>(size), 6) != Z_OK)
+                {
+                    throw std::runtime_error("ERROR: zlib compression failed");
+                }
+                out.resize(outSize);
+                return;
+            }
+#endif
+#ifdef LMA_HAVE_LZ4
+            case LZ4:
+            {
+                out.resize(LZ4_compressBound(static_cast<int>(size)));
+                const int outSize = LZ4_compress_default(shuffled.data(), out.data(), static_cast<int>(size),
+                                                         static_cast<int>(out.size()));
+                if (outSize <= 0)
+                {
+                    throw std::runtime_error("ERROR: lz4 compression failed");
+                }
+                out.resize(outSize);
+                return;
+            }
+#endif
+#ifdef LMA_HAVE_ZSTD
+            case ZSTD:
+            {
+                out.resize(ZSTD_compressBound(size));
+                const size_t outSize = ZSTD_compress(out.data(), out.size(), shuffled.data(), size, 3);
+                if (ZSTD_isError(outSize))
+                {
+                    throw std::runtime_error(std::string("ERROR: zstd compression failed: ") + ZSTD_getErrorName(outSize));
+                }
+                out.resize(outSize);
+                return;
+            }
+#endif
+            case RAW:
+                out.swap(shuffled);
+                return;
+            default:
+                throw std::runtime_error("ERROR: the codec '" + codecName(codec) + "' is not available in this build");
+        }
+    }
+
+    void TileFile::decompress(const Codec codec, const char* data, const size_t size,
+                              const size_t nValues, std::vector<char>& scratch, double* out)
+    {
+        const size_t outSize = nValues * sizeof(double);
+        scratch.resize(outSize);
+        bool isValid = false;
+
+        switch (codec)
+        {
+#ifdef LMA_HAVE_ZLIB
+            case ZLIB:
+            {
+                uLongf length = static_cast<uLongf>(outSize);
+                isValid = uncompress(reinterpret_cast<Bytef*>(scratch.data()), &length,
+                                     reinterpret_cast<const Bytef*>(data), static_cast<uLong>(size)) == Z_OK &&
+                          length == outSize;
+                break;
+            }
+#endif
+#ifdef LMA_HAVE_LZ4
+            case LZ4:
+                isValid = LZ4_decompress_safe(data, scratch.data(), static_cast<int>(size),
+                                              static_cast<int>(outSize)) == static_cast<int>(outSize);
+                break;
+#endif
+#ifdef LMA_HAVE_ZSTD
+            case ZSTD:
+                isValid = ZSTD_decompress(scratch.data(), outSize, data, size) == outSize;
+                break;
+#endif
+            case RAW:
+                isValid = size == outSize;
+                if (isValid)
+                    std::memcpy(scratch.data(), data, size);
+                break;
+            default:
+                throw std::runtime_error("ERROR: the codec '" + codecName(codec) + "' is not available in this build");
+        }
+
+        if (!isValid)
+        {
+            throw std::runtime_error("ERROR: corrupted tile in the tile file");
+        }
+        unshuffle(scratch.data(), nValues, out);
+    }
+
+    void TileFile::convert(std::istream& inStream, const size_t nSkip,
+                           const size_t nx, const size_t ny, const size_t nz, const size_t tileSize,
+                           const Codec codec, const std::string& fileName, const size_t nThreads)
+    {
+        if (tileSize == 0)
+        {
+            throw std::runtime_error("ERROR: the tile size must be positive");
+        }
+        if (!isAvailable(codec))
+        {
+            throw std::runtime_error("ERROR: the codec '" + codecName(codec) + "' is not available in this build");
+        }
+
+        char line[256];
+        for (size_t i = 0; i < nSkip; i++)
+        {
+            inStream.getline(line, 256);
+        }
+
+        const size_t ntx = (nx + tileSize - 1) / tileSize;
+        const size_t nty = (ny + tileSize - 1) / tileSize;
+        const size_t ntz = (nz + tileSize - 1) / tileSize;
+        const size_t nTiles = ntx * nty * ntz;
+
+        std::ofstream outStream(fileName, std::ios::binary);
+        if (!outStream)
+        {
+            throw std::runtime_error("ERROR: cannot open the file " + fileName);
+        }
+        uint64_t header[HEADER_WORDS] = {MAGIC, VERSION, nx, ny, nz, tileSize, tileSize, tileSize,
+                                         static_cast<uint64_t>(codec), nTiles, 0, 0, 0, 0, 0, 0};
+        outStream.write(reinterpret_cast<const char*>(header), sizeof(header));
+        std::vector<uint64_t> index(2 * nTiles, 0);
+        outStream.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(uint64_t));
+        uint64_t offset = sizeof(header) + index.size() * sizeof(uint64_t);
+
+        const size_t nWorkers = std::max<size_t>(std::min(nThreads, ntx * nty), 1);
+        std::vector<double> slab;
+        for (size_t tk = 0; tk < ntz; tk++)
+        {
+            // One slab of tiles along z
+            const size_t k0 = tk * tileSize;
+            const size_t k1 = std::min(k0 + tileSize, nz);
+            slab.resize(nx * ny * (k1 - k0));
+            for (auto& value : slab)
+            {
+                if (!(inStream >> value))
+                {
+                    throw std::runtime_error("ERROR: not enough values in the field file");
+                }
+            }
+
+            std::vector<std::vector<char>> compressed(ntx * nty);
+            std::vector<std::exception_ptr> errors(nWorkers);
+            std::vector<std::thread> workers;
+            for (size_t w = 0; w < nWorkers; w++)
+            {
+                workers.emplace_back([&, w]()
+                {
+                    try
+                    {
+                        std::vector<double> values;
+                        for (size_t t = w; t < ntx * nty; t += nWorkers)
+                        {
+                            const size_t i0 = (t % ntx) * tileSize, i1 = std::min(i0 + tileSize, nx);
+                            const size_t j0 = (t / ntx) * tileSize, j1 = std::min(j0 + tileSize, ny);
+                            values.clear();
+                            for (size_t k = 0; k < k1 - k0; k++)
+                                for (size_t j = j0; j < j1; j++)
+                                    for (size_t i = i0; i < i1; i++)
+                                        values.push_back(slab[(k * ny + j) * nx + i]);
+                            compress(codec, values, compressed[t]);
+                        }
+                    }
+                    catch (...)
+                    {
+                        errors[w] = std::current_exception();
+                    }
+                });
+            }
+            for (auto& worker : workers)
+                worker.join();
+            for (auto& error : errors)
+            {
+                if (error)
+                    std::rethrow_exception(error);
+            }
+
+            for (size_t t = 0; t < ntx * nty; t++)
+            {
+                const size_t tileId = tk * ntx * nty + t;
+                index[2 * tileId] = offset;
+                index[2 * tileId + 1] = compressed[t].size();
+                outStream.write(compressed[t].data(), compressed[t].size());
+                offset += compressed[t].size();
+            }
+        }
+
+        outStream.seekp(sizeof(header));
+        outStream.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(uint64_t));
+        if (!outStream)
+        {
+            throw std::runtime_error("ERROR: cannot write the file " + fileName);
+        }
+        outStream.close();
+    }
+
+    TileFile::TileFile(const std::string& fileName) : fileName(fileName), data(nullptr), dataSize(0)
+    {
+#ifndef _WIN32
+        const int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("ERROR: cannot find the file " + fileName);
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("ERROR: cannot read the size of the file " + fileName);
+        }
+        dataSize = static_cast<size_t>(info.st_size);
+        if (dataSize > 0)
+        {
+            void* mapped = mmap(nullptr, dataSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED)
+            {
+                close(fd);
+                throw std::runtime_error("ERROR: cannot map the file " + fileName);
+            }
+            data = static_cast<const char*>(mapped);
+        }
+        close(fd);
+#else
+        std::ifstream inStream(fileName, std::ios::binary);
+        if (!inStream)
+        {
+            throw std::runtime_error("ERROR: cannot find the file " + fileName);
+        }
+        buffer.assign(std::istreambuf_iterator<char>(inStream), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        dataSize = buffer.size();
+#endif
+
+        uint64_t header[HEADER_WORDS];
+        if (dataSize < sizeof(header))
+        {
+            throw std::runtime_error("ERROR: " + fileName + " is not a tile file");
+        }
+        std::memcpy(header, data, sizeof(header));
+        if (header[0] != MAGIC || header[1] != VERSION)
+        {
+            throw std::runtime_error("ERROR: " + fileName + " is not a tile file (or has a different version)");
+        }
+        for (size_t d = 0; d < 3; d++)
+        {
+            dims[d] = header[2 + d];
+            tile[d] = header[5 + d];
+            if (tile[d] == 0)
+            {
+                throw std::runtime_error("ERROR: invalid tile size in " + fileName);
+            }
+            nTilesAxis[d] = (dims[d] + tile[d] - 1) / tile[d];
+        }
+        fileCodec = static_cast<Codec>(header[8]);
+        nTiles = header[9];
+        if (nTiles != nTilesAxis[0] * nTilesAxis[1] * nTilesAxis[2] ||
+            dataSize < sizeof(header) + 2 * nTiles * sizeof(uint64_t))
+        {
+            throw std::runtime_error("ERROR: invalid tile index in " + fileName);
+        }
+        if (!isAvailable(fileCodec))
+        {
+            throw std::runtime_error("ERROR: " + fileName + " uses the codec '" + codecName(fileCodec) +
+                                     "' which is not available in this build");
+        }
+
+        offsets.resize(nTiles);
+        sizes.resize(nTiles);
+        const char* index = data + sizeof(header);
+        for (size_t t = 0; t < nTiles; t++)
+        {
+            std::memcpy(&offsets[t], index + 2 * t * sizeof(uint64_t), sizeof(uint64_t));
+            std::memcpy(&sizes[t], index + (2 * t + 1) * sizeof(uint64_t), sizeof(uint64_t));
+            if (offsets[t] > dataSize || sizes[t] > dataSize - offsets[t])
+            {
+                throw std::runtime_error("ERROR: invalid tile index in " + fileName);
+            }
+        }
+    }
+
+    TileFile::~TileFile()
+    {
+#ifndef _WIN32
+        if (data != nullptr)
+            munmap(const_cast<char*>(data), dataSize);
+#endif
+    }
+
+    size_t TileFile::tileOf(const size_t i, const size_t j, const size_t k) const
+    {
+        return ((k / tile[2]) * nTilesAxis[1] + j / tile[1]) * nTilesAxis[0] + i / tile[0];
+    }
+
+    std::array<size_t, 6> TileFile::tileBox(const size_t t) const
+    {
+        const size_t ti = t % nTilesAxis[0];
+        const size_t tj = (t / nTilesAxis[0]) % nTilesAxis[1];
+        const size_t tk = t / (nTilesAxis[0] * nTilesAxis[1]);
+        return {{ti * tile[0], tj * tile[1], tk * tile[2],
+                 std::min((ti + 1) * tile[0], dims[0]),
+                 std::min((tj + 1) * tile[1], dims[1]),
+                 std::min((tk + 1) * tile[2], dims[2])}};
+    }
+
+    void TileFile::readTile(const size_t t, std::vector<double>& values) const
+    {
+        const auto box = tileBox(t);
+        const size_t nValues = (box[3] - box[0]) * (box[4] - box[1]) * (box[5] - box[2]);
+        values.resize(nValues);
+        std::vector<char> scratch;
+        decompress(fileCodec, data + offsets[t], sizes[t], nValues, scratch, values.data());
+    }
+
+    std::vector<double> TileFile::readAll(const size_t nThreads) const
+    {
+        std::vector<double> all(dims[0] * dims[1] * dims[2]);
+        const size_t nWorkers = std::max<size_t>(std::min(nThreads, nTiles), 1);
+        std::vector<std::exception_ptr> errors(nWorkers);
+        std::vector<std::thread> workers;
+        for (size_t w = 0; w < nWorkers; w++)
+        {
+            workers.emplace_back([this, w, nWorkers, &all, &errors]()
+            {
+                try
+                {
+                    std::vector<double> values;
+                    for (size_t t = w; t < nTiles; t += nWorkers)
+                    {
+                        readTile(t, values);
+                        const auto box = tileBox(t);
+                        size_t n = 0;
+                        for (size_t k = box[2]; k < box[5]; k++)
+                            for (size_t j = box[1]; j < box[4]; j++)
+                                for (size_t i = box[0]; i < box[3]; i++)
+                                    all[(k * dims[1] + j) * dims[0] + i] = values[n++];
+                    }
+                }
+                catch (...)
+                {
+                    errors[w] = std::current_exception();
+                }
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+        for (auto& error : errors)
+        {
+            if (error)
+                std::rethrow_exception(error);
+        }
+        return all;
+    }
+}
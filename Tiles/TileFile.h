@@ -0,0 +1,119 @@
+/**
+* @file TileFile.h
+* @brief Container of a conductivity field split in fixed size 3D tiles,
+*        each one compressed independently, with an index of the tiles
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_TILEFILE_H
+#define LMA_TILEFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <istream>
+
+namespace lma {
+
+    /**
+     * File layout (native endianness, 64 bit words):
+     *   header    magic, version, nx, ny, nz, tile size in x, y and z, codec, number of tiles,
+     *             6 reserved words
+     *   index     offset in the file and compressed size of each tile
+     *   tiles     values of each tile (x fastest, as in field.dat), byte shuffled (the i-th
+     *             bytes of all the doubles together) and compressed
+     * The values are those of the text file (e.g. log conductivity), nx, ny and nz are the
+     * numbers of values in the text file (the grid before refinement). Tiles are numbered
+     * with x fastest, the last ones along each axis can be smaller.
+     */
+    class TileFile {
+
+    public:
+
+        enum Codec { RAW = 0, ZLIB = 1, LZ4 = 2, ZSTD = 3 };
+
+        // Codecs compiled in (RAW always is)
+        static bool isAvailable(const Codec codec);
+        static Codec bestCodec();
+        static Codec codecFromName(const std::string& name);
+        static std::string codecName(const Codec codec);
+
+        // Convert the text layout of field.dat (after nSkip header lines) into a tile file.
+        // The text is read one slab of tiles at a time, the tiles of a slab are compressed
+        // by nThreads threads.
+        static void convert(std::istream& inStream, const size_t nSkip,
+                            const size_t nx, const size_t ny, const size_t nz, const size_t tileSize,
+                            const Codec codec, const std::string& fileName, const size_t nThreads);
+
+        // Open a tile file for reading (memory mapped where available)
+        explicit TileFile(const std::string& fileName);
+
+        TileFile(const TileFile&) = delete;
+        TileFile& operator=(const TileFile&) = delete;
+
+        ~TileFile();
+
+        size_t nx() const { return dims[0]; };
+        size_t ny() const { return dims[1]; };
+        size_t nz() const { return dims[2]; };
+        size_t numberOfTiles() const { return nTiles; };
+        Codec codec() const { return fileCodec; };
+
+        // Tile containing the value (i, j, k)
+        size_t tileOf(const size_t i, const size_t j, const size_t k) const;
+
+        // First and one past the last (i, j, k) of a tile
+        std::array<size_t, 6> tileBox(const size_t tile) const;
+
+        // Values of a tile, x fastest (safe to call from several threads)
+        void readTile(const size_t tile, std::vector<double>& values) const;
+
+        // All the values in the order of field.dat, the tiles are decompressed by nThreads threads
+        std::vector<double> readAll(const size_t nThreads) const;
+
+    private:
+
+        static void compress(const Codec codec, const std::vector<double>& values, std::vector<char>& out);
+        static void decompress(const Codec codec, const char* data, const size_t size,
+                               const size_t nValues, std::vector<char>& scratch, double* out);
+
+        static const uint64_t MAGIC = 0x3153454c49544d4cULL; // "LMTILES1"
+        static const uint64_t VERSION = 1;
+        static const size_t HEADER_WORDS = 16;
+
+        std::string fileName;
+        std::array<size_t, 3> dims;
+        std::array<size_t, 3> tile;
+        std::array<size_t, 3> nTilesAxis;
+        size_t nTiles;
+        Codec fileCodec;
+        std::vector<uint64_t> offsets;
+        std::vector<uint64_t> sizes;
+
+        const char* data;
+        size_t dataSize;
+        std::vector<char> buffer;
+
+    };
+}
+
+#endif //LMA_TILEFILE_H
@@ -0,0 +1,122 @@
+/**
+* @file TileLoader.h
+* @brief Load the tiles of a tile file only when the search reaches them
+*
+* @author Calogero B. Rizzo
+*
+* @copyright This file is part of the lazymole software.
+*            Copyright (C) 2019 Calogero B. Rizzo
+*
+* @license This program is free software: you can redistribute it and/or modify
+*          it under the terms of the GNU General Public License as published by
+*          the Free Software Foundation, either version 3 of the License, or
+*          (at your option) any later version.
+*
+*          This program is distributed in the hope that it will be useful,
+*          but WITHOUT ANY WARRANTY; without even the implied warranty of
+*          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*          GNU General Public License for more details.
+*
+*          You should have received a copy of the GNU General Public License
+*          along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LMA_TILELOADER_H
+#define LMA_TILELOADER_H
+
+#include <cstddef>
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <CartesianGrid.h>
+#include <CellField.h>
+#include <LazyMole.h>
+#include "TileFile.h"
+
+namespace lma {
+
+    /**
+     * Field loader of LazyMole: before the neighbors of a settled cell are relaxed, the tiles
+     * containing the cell and its neighbors are decompressed into the conductivity field and
+     * into the solver. A search stopped at the targets then reads only the tiles it reaches.
+     */
+    class TileLoader {
+
+    public:
+
+        TileLoader(const TileFile& file, mla::CartesianGrid* grid, mla::ConductivityField& conductivity,
+                   const bool isLog) :
+                file(file), gridPtr(grid), conductivity(conductivity), isLog(isLog),
+                isLoaded(file.numberOfTiles(), 0), nLoaded(0), lazyMolePtr(nullptr) {
+            if (file.nx() * grid->resx() != grid->nx() || file.ny() * grid->resy() != grid->ny() ||
+                file.nz() * grid->resz() != grid->nz()) {
+                throw std::runtime_error("ERROR: the tile file does not match the size of the grid");
+            }
+        };
+
+        // Load the tiles on demand during the runs of lazyMole
+        void attach(mla::LazyMole& lazyMole) {
+            lazyMolePtr = &lazyMole;
+            lazyMole.setFieldLoader([this](const size_t cell) { load(cell); });
+        }
+
+        // Load the tiles of a cell and of its neighbors
+        void load(const size_t cell) {
+            const auto ids = gridPtr->splitId(cell);
+            loadValue(ids[0], ids[1], ids[2]);
+            for (const auto& s : gridPtr->offsets()) {
+                const long x = static_cast<long>(ids[0]) + s[0];
+                const long y = static_cast<long>(ids[1]) + s[1];
+                const long z = static_cast<long>(ids[2]) + s[2];
+                if (x < 0 || y < 0 || z < 0 || x >= static_cast<long>(gridPtr->nx()) ||
+                    y >= static_cast<long>(gridPtr->ny()) || z >= static_cast<long>(gridPtr->nz()))
+                    continue;
+                loadValue(static_cast<size_t>(x), static_cast<size_t>(y), static_cast<size_t>(z));
+            }
+        }
+
+        size_t loadedTiles() const {
+            return nLoaded;
+        }
+
+    private:
+
+        void loadValue(const size_t x, const size_t y, const size_t z) {
+            const size_t tile = file.tileOf(x / gridPtr->resx(), y / gridPtr->resy(), z / gridPtr->resz());
+            if (isLoaded[tile])
+                return;
+            isLoaded[tile] = 1;
+            nLoaded++;
+
+            file.readTile(tile, values);
+            const auto box = file.tileBox(tile);
+            size_t n = 0;
+            for (size_t k = box[2]; k < box[5]; k++)
+                for (size_t j = box[1]; j < box[4]; j++)
+                    for (size_t i = box[0]; i < box[3]; i++) {
+                        const double value = isLog ? std::exp(values[n++]) : values[n++];
+                        for (size_t rx = gridPtr->resx()*i; rx < gridPtr->resx()*(i+1); rx++)
+                            for (size_t ry = gridPtr->resy()*j; ry < gridPtr->resy()*(j+1); ry++)
+                                for (size_t rz = gridPtr->resz()*k; rz < gridPtr->resz()*(k+1); rz++) {
+                                    const size_t cell = gridPtr->mergeIds(rx, ry, rz);
+                                    conductivity[cell] = value;
+                                    if (lazyMolePtr)
+                                        lazyMolePtr->setConductivity(cell, value);
+                                }
+                    }
+        }
+
+        const TileFile& file;
+        mla::CartesianGrid* gridPtr;
+        mla::ConductivityField& conductivity;
+        bool isLog;
+
+        std::vector<char> isLoaded;
+        size_t nLoaded;
+        std::vector<double> values;
+        mla::LazyMole* lazyMolePtr;
+
+    };
+}
+
+#endif //LMA_TILELOADER_H
@@ -26,11 +26,28 @@
 #include <Point.h>
 #include <Vector.h>
 #include <CellField.h>
+#include <ActiveCellField.h>
+#include <FieldAllocator.h>
 #include <LazyMole.h>
+#include <Multilevel.h>
+#include <LocalConnectivity.h>
+#include <FlowCorridor.h>
+#include <ResultCache.h>
 #include <chrono>
+#include <memory>
 #include <sstream>
 #include <iomanip>
 #include <Input.h>
+#include <Streams.h>
+#include <Regions.h>
+#include <Server.h>
+#include <Ensemble.h>
+#include <TileFile.h>
+#include <TileLoader.h>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <csignal>
 
 class Timer
 {
@@ -47,24 +64,34 @@ private:
     std::chrono::time_point<clock_> beg_;
 };
 
-std::vector<size_t> loadIds(std::string fileName)
+// Set by SIGINT and SIGTERM during the run: the run stops at the next sample of its progress
+std::atomic<bool> isCancelRequested(false);
+
+extern "C" void requestCancel(int)
 {
-    std::ifstream inStream;
-    inStream.open(fileName, std::ifstream::in);
-    if (!inStream)
-    {
-        throw std::runtime_error("ERROR: cannot find the file " + fileName);
-    }
+    isCancelRequested = true;
+}
 
-    std::vector<size_t> ids;
-    size_t id;
-    while (inStream >> id)
+mla::Averaging averagingFromName(const std::string& name)
+{
+    if (name == "arithmetic")
+        return mla::ARITHMETIC;
+    if (name == "geometric")
+        return mla::GEOMETRIC;
+    if (name == "harmonic")
+        return mla::HARMONIC;
+    throw std::runtime_error("ERROR: unknown averaging '" + name + "' (use 'arithmetic', 'geometric' or 'harmonic')");
+}
+
+// The modes that run their own searches do not use the settings of the single search
+void warnIgnoredSettings(const lma::Input& config, const std::string& mode)
+{
+    if (config.hasCache() || config.hasCheckpoint() || config.queue() == "bucket" ||
+        config.stopAtTargets() || config.maxResistance() < std::numeric_limits<double>::max())
     {
-        ids.push_back(id);
+        std::cerr << "WARNING: the cache, the checkpoints, the queue and the stop criteria are not used in " << mode
+                  << " mode" << std::endl;
     }
-    inStream.close();
-
-    return ids;
 }
 
 void run(int argc, char** argv)
@@ -72,6 +99,121 @@ void run(int argc, char** argv)
     Timer timer;
     const double tStart = timer.elapsed();
 
+    // Parse the command line
+    std::string configPath;
+    bool isServer = false;
+    std::string socketPath;
+    size_t nWorkspaces = std::max(std::thread::hardware_concurrency(), 1u);
+    std::string convertName;
+    size_t tileSize = 32;
+    std::string codecName;
+    bool showProgress = false;
+    const std::string usage = "use 'lazyMole [--serve | --socket /path/to/socket] [--workspaces N] [--progress] /path/to/config/'"
+                              " or 'lazyMole --convert field.lmt [--tile N] [--codec raw|zlib|lz4|zstd] /path/to/config/'";
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--serve")
+        {
+            isServer = true;
+        }
+        else if (arg == "--socket" && i + 1 < argc)
+        {
+            isServer = true;
+            socketPath = argv[++i];
+        }
+        else if (arg == "--workspaces" && i + 1 < argc)
+        {
+            nWorkspaces = std::stoul(argv[++i]);
+        }
+        else if (arg == "--progress")
+        {
+            showProgress = true;
+        }
+        else if (arg == "--convert" && i + 1 < argc)
+        {
+            convertName = argv[++i];
+        }
+        else if (arg == "--tile" && i + 1 < argc)
+        {
+            tileSize = std::stoul(argv[++i]);
+        }
+        else if (arg == "--codec" && i + 1 < argc)
+        {
+            codecName = argv[++i];
+        }
+        else if (arg.compare(0, 2, "--") == 0)
+        {
+            throw std::runtime_error("ERROR: unknown option '" + arg + "' (" + usage + ")");
+        }
+        else if (configPath.empty())
+        {
+            configPath = arg;
+            if (configPath.back() != '/' && configPath.back() != '\\')
+            {
+                configPath.push_back('/');
+            }
+        }
+        else
+        {
+            throw std::runtime_error("ERROR: too many arguments (" + usage + ")");
+        }
+    }
+
+    std::string configName = configPath + "config.yaml";
+    lma::Input config(configName);
+
+    // The server and the connectivity mode read no sources and targets (the queries give them)
+    const bool hasRegions = !isServer && !config.hasConnectivity();
+
+    // Inputs and outputs named '-' use the standard input and output, only one of each
+    size_t nStandardInputs = 0;
+    for (auto& name : {hasRegions && config.hasRegionFile("source") ? config.source() : std::string(),
+                       hasRegions && config.hasRegionFile("target") ? config.target() : std::string(), config.field(),
+                       config.hasMaskFile() ? config.maskFile() : std::string()})
+    {
+        nStandardInputs += lma::isStandardStream(name) ? 1 : 0;
+    }
+    std::vector<std::string> outputs = {config.outputRes(), config.outputPath(),
+                                        config.outputCorridorMask(), config.outputCorridorSlack()};
+    if (config.hasOutputPaths())
+        outputs.push_back(config.outputPaths());
+    if (config.hasOutputLabels())
+        outputs.push_back(config.outputLabels());
+    if (config.hasOutputLabelTargets())
+        outputs.push_back(config.outputLabelTargets());
+    if (config.hasOutputSensitivity())
+        outputs.push_back(config.outputSensitivity());
+    if (config.hasConnectivity())
+        outputs.push_back(config.connectivityFile());
+    const std::vector<std::string> attributeNames = {"length", "steps", "minK", "maxK"};
+    bool hasAttributes = false;
+    for (auto& name : attributeNames)
+    {
+        if (config.hasOutputAttribute(name))
+        {
+            outputs.push_back(config.outputAttribute(name));
+            hasAttributes = true;
+        }
+    }
+    const size_t nStandardOutputs = std::count_if(outputs.begin(), outputs.end(), lma::isStandardStream);
+    if (nStandardInputs > 1 || nStandardOutputs > 1)
+    {
+        throw std::runtime_error("ERROR: only one input and one output can use the standard input/output ('-')");
+    }
+    if (isServer && socketPath.empty() && nStandardInputs > 0)
+    {
+        throw std::runtime_error("ERROR: the server reads the queries from the standard input, no input can be '-'");
+    }
+
+    // The answers of the server and the output named '-' use the standard output,
+    // the messages then go to the standard error
+    std::ostream protocolStream(std::cout.rdbuf());
+    if ((isServer && socketPath.empty()) || nStandardOutputs > 0)
+    {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
     std::cout << "*********************************************************" << std::endl;
     std::cout << "*-------------------------------------------------------*" << std::endl;
     std::cout << "*------------------- THE LAZY MOLE 3D ------------------*" << std::endl;
@@ -87,31 +229,15 @@ void run(int argc, char** argv)
     std::cout << "*********************************************************" << std::endl;
     std::cout << std::endl;
 
-    std::string configPath;
-    if (argc == 1)
-    {
-        configPath = "";
-    }
-    else if (argc == 2)
-    {
-        configPath = std::string(argv[1]);
-
-        if (configPath.back() != '/' && configPath.back() != '\\')
-        {
-            configPath.push_back('/');
-        }
-    }
-    else
-    {
-        throw std::runtime_error("ERROR: too many arguments (use 'lazyMole /path/to/config/')");
-    }
-
-    std::string configName = configPath + "config.yaml";
-
     std::cout << "Looking for configuration file '" << configName << "'... " << std::flush;
-    lma::Input config(configName);
     std::cout << "OK!" << std::endl;
 
+    // Placement of the large fields (before any field is created)
+    mla::MemoryPolicy& memory = mla::MemoryPolicy::global();
+    memory.pages = mla::MemoryPolicy::pagesFromString(config.memoryPages());
+    memory.placement = mla::MemoryPolicy::placementFromString(config.memoryPlacement());
+    memory.threads = config.memoryThreads();
+
     // Load parameters
     size_t nx = config.nx();
     size_t ny = config.ny();
@@ -128,70 +254,585 @@ void run(int argc, char** argv)
     // Define grid
     std::cout << "Preparing grid... " << std::flush;
     auto grid = new mla::CartesianGrid(nx, ny, nz, dx, dy, dz, refx, refy, refz);
+    grid->setStencil(mla::stencilFromConnectivity(config.connectivity(), grid->nz() == 1));
     std::cout << "OK!" << std::endl;
 
-    // Load source ids
-    std::cout << "Loading source ids from '" << configPath + config.source() << "'... " << std::flush;
-    auto ids = loadIds(configPath + config.source());
-    std::cout << "OK!" << std::endl;
+    // Conversion of the text field into a tile file (see Tiles/TileFile.h)
+    if (!convertName.empty())
+    {
+        const lma::TileFile::Codec codec = codecName.empty() ? lma::TileFile::bestCodec()
+                                                             : lma::TileFile::codecFromName(codecName);
+        const std::string fieldName = lma::resolvePath(configPath, config.field());
+        const std::string tileName = lma::resolvePath(configPath, convertName);
+        if (fieldName.size() > 4 && fieldName.compare(fieldName.size() - 4, 4, ".lmt") == 0)
+        {
+            throw std::runtime_error("ERROR: the field to convert must be a text file (" + fieldName + ")");
+        }
+        std::cout << "Converting field from '" << fieldName << "' to '" << tileName << "' (tiles of "
+                  << tileSize << "^3 values, " << lma::TileFile::codecName(codec) << ")... " << std::flush;
+        lma::InputStream inStream(fieldName);
+        lma::TileFile::convert(inStream.get(), config.fieldSkip(), nx, ny, nz, tileSize, codec, tileName, nWorkspaces);
+        std::cout << "OK!" << std::endl;
 
-    // Load target ids
-    std::cout << "Loading target ids from '" << configPath + config.target() << "'... " << std::flush;
-    auto idsTarget = loadIds(configPath + config.target());
-    std::cout << "OK!" << std::endl;
+        delete grid;
+        std::cout << std::endl;
+        std::cout << "Time elapsed = " << timer.elapsed() - tStart << "s" << std::endl;
+        std::cout << std::endl;
+        return;
+    }
+
+    // Load source and target ids
+    std::vector<size_t> ids;
+    std::vector<size_t> idsTarget;
+    if (hasRegions)
+    {
+        std::cout << "Loading source cells... " << std::flush;
+        ids = lma::loadRegion(config, "source", configPath, grid);
+        std::cout << "OK! (" << ids.size() << " cells)" << std::endl;
+
+        std::cout << "Loading target cells... " << std::flush;
+        idsTarget = lma::loadRegion(config, "target", configPath, grid);
+        std::cout << "OK! (" << idsTarget.size() << " cells)" << std::endl;
+    }
 
     // Define conductivity field
     std::cout << "Preparing field... " << std::flush;
     mla::ConductivityField conductivity(grid);
     std::cout << "OK!" << std::endl;
 
-    // Open conductivity file
-    std::cout << "Loading field from '" << configPath + config.field() << "'... " << std::flush;
-    std::ifstream inStream;
-    inStream.open(configPath + config.field(), std::ifstream::in);
-    if (!inStream)
-    {
-        throw std::runtime_error("ERROR: cannot find the field file " + config.field());
-    }
+    // Load conductivity: text file or stream, raw doubles in a shared memory segment,
+    // or tile file (.lmt) decompressed in parallel or loaded on demand by the search
+    const std::string fieldName = lma::resolvePath(configPath, config.field());
+    const bool isTileFile = fieldName.size() > 4 && fieldName.compare(fieldName.size() - 4, 4, ".lmt") == 0;
+    const bool isLazyField = config.fieldLazy();
+    std::unique_ptr<lma::TileFile> tileFile;
+    std::cout << (isLazyField ? "Opening field '" : "Loading field from '") << fieldName << "'... " << std::flush;
     size_t skip = config.fieldSkip();
     bool log = config.fieldLog();
-
-    // Load conductivity
-    conductivity.import(inStream, skip, 1.0, log);
-    inStream.close();
+    if (isLazyField && !isTileFile)
+    {
+        throw std::runtime_error("ERROR: only tile files (.lmt) can be loaded on demand");
+    }
+    if (isTileFile)
+    {
+        tileFile.reset(new lma::TileFile(fieldName));
+        if (tileFile->nx() != nx || tileFile->ny() != ny || tileFile->nz() != nz)
+        {
+            throw std::runtime_error("ERROR: the tile file does not match the size of the grid");
+        }
+        if (!isLazyField)
+        {
+            const auto values = tileFile->readAll(config.threads() > 0 ? config.threads() : nWorkspaces);
+            conductivity.import(values.data(), values.size(), log);
+        }
+    }
+    else if (lma::isSharedMemory(fieldName))
+    {
+        lma::SharedMemory segment(fieldName);
+        conductivity.import(reinterpret_cast<const double*>(segment.data()), segment.size() / sizeof(double), log);
+    }
+    else
+    {
+        lma::InputStream inStream(fieldName);
+        conductivity.import(inStream.get(), skip, 1.0, log);
+    }
     std::cout << "OK!" << std::endl;
 
+    // Define active cells
+    std::unique_ptr<mla::ActiveCells> active;
+    if (isLazyField && (config.hasMaskFile() || config.hasMaskThreshold() || isServer))
+    {
+        throw std::runtime_error("ERROR: a field loaded on demand cannot be used with a mask or in server mode");
+    }
+    if (config.hasMaskFile() || config.hasMaskThreshold())
+    {
+        mla::MaskField mask(grid);
+        if (config.hasMaskFile())
+        {
+            std::cout << "Loading mask from '" << lma::resolvePath(configPath, config.maskFile()) << "'... " << std::flush;
+            lma::InputStream maskStream(lma::resolvePath(configPath, config.maskFile()));
+            mask.import(maskStream.get(), config.maskSkip());
+            std::cout << "OK!" << std::endl;
+        }
+        if (config.hasMaskThreshold())
+        {
+            mask.threshold(conductivity, config.maskThreshold());
+        }
+        active.reset(new mla::ActiveCells(grid, mask.mask()));
+        std::cout << "Active cells = " << active->size() << " of " << grid->numberOfCells() << std::endl;
+    }
+
+    // Server mode: answer queries on the loaded field
+    if (isServer)
+    {
+        // Each query stops at its first target, within the max resistance. The bucket queue would size its
+        // buckets on the whole field at each query, the cache and the checkpoints hold a single search.
+        if (config.queue() == "bucket")
+        {
+            throw std::runtime_error("ERROR: the server answers with the heap queue, remove 'solver: queue: bucket'");
+        }
+        if (config.hasCache() || config.hasCheckpoint())
+        {
+            std::cerr << "WARNING: the cache and the checkpoints are not used in server mode" << std::endl;
+        }
+        lma::Server server(grid, conductivity, active.get(), nWorkspaces, config.maxResistance());
+        if (socketPath.empty())
+        {
+            std::cout << "Serving queries on the standard input (" << nWorkspaces << " workspaces)..." << std::endl;
+            server.serve(std::cin, protocolStream);
+        }
+        else
+        {
+            std::cout << "Serving queries on '" << socketPath << "' (" << nWorkspaces << " workspaces)..." << std::endl;
+            server.serveSocket(socketPath);
+        }
+        delete grid;
+        return;
+    }
+
+    // Connectivity mode: windowed MHR from every cell (see Core/LocalConnectivity.h)
+    if (config.hasConnectivity())
+    {
+        if (isLazyField)
+        {
+            throw std::runtime_error("ERROR: the connectivity mode needs the whole field, it cannot be loaded on demand");
+        }
+        const size_t nConnectivityThreads = config.threads() > 0 ? config.threads() : nWorkspaces;
+        std::cout << "Computing local connectivity (radius " << config.connectivityRadius() << " cells, "
+                  << nConnectivityThreads << " threads)... " << std::flush;
+        const double t1 = timer.elapsed();
+        mla::LocalConnectivity connectivity(grid, conductivity, active.get());
+        connectivity.setRadius(config.connectivityRadius());
+        connectivity.setThreads(nConnectivityThreads);
+        const auto indicator = connectivity.run();
+        const double t2 = timer.elapsed();
+        std::cout << "OK!" << std::endl;
+
+        const std::string connectivityName = lma::resolvePath(configPath, config.connectivityFile());
+        std::cout << "Exporting local connectivity to '" << connectivityName << "'... " << std::flush;
+        lma::OutputStream outStream(connectivityName, protocolStream);
+        if (config.outputResFormat() == "sparse")
+        {
+            indicator.exportSparseToStream(outStream.get(), std::numeric_limits<double>::max());
+        }
+        else
+        {
+            indicator.exportToStream(outStream.get());
+        }
+        outStream.close();
+        std::cout << "OK!" << std::endl;
+
+        delete grid;
+        std::cout << std::endl;
+        std::cout << "Time elapsed = " << timer.elapsed() - tStart << "s (connectivity time = " << t2 - t1 << "s)" << std::endl;
+        std::cout << std::endl;
+        return;
+    }
+
+    // Solver settings (read once, the solvers of the ensemble are configured from several threads)
+    if (config.queue() != "heap" && config.queue() != "bucket")
+    {
+        throw std::runtime_error("ERROR: unknown queue '" + config.queue() + "' (use 'heap' or 'bucket')");
+    }
+    if (config.queue() == "bucket" && config.epsilon() <= 0.)
+    {
+        throw std::runtime_error("ERROR: epsilon must be positive with the bucket queue");
+    }
+    const bool stopAtTargets = config.stopAtTargets();
+    const double maxResistance = config.maxResistance();
+    const double epsilon = config.queue() == "bucket" ? config.epsilon() : 0.;
+    auto configureSolver = [idsTarget, stopAtTargets, maxResistance, epsilon](mla::LazyMole& solver)
+    {
+        if (stopAtTargets)
+        {
+            solver.setTargets(idsTarget);
+        }
+        solver.setMaxResistance(maxResistance);
+        solver.setApproximation(epsilon);
+    };
+
+    // Ensemble mode: pipelined runs over many realizations of the field
+    if (config.hasEnsemble())
+    {
+        // The active cells are shared by all the realizations, a threshold on the base field
+        // would not mask the low conductivity cells of the others
+        if (config.hasMaskThreshold())
+        {
+            throw std::runtime_error("ERROR: the mask threshold cannot be used in ensemble mode (use a mask file)");
+        }
+        lma::EnsembleSettings settings;
+        settings.first = config.ensembleFirst();
+        settings.count = config.ensembleRealizations();
+        settings.fieldFile = lma::resolvePath(configPath, config.ensembleField());
+        settings.fieldSkip = skip;
+        settings.fieldLog = log;
+        settings.resistanceFile = config.ensembleResistance().empty() ? "" : lma::resolvePath(configPath, config.ensembleResistance());
+        settings.pathFile = config.ensemblePath().empty() ? "" : lma::resolvePath(configPath, config.ensemblePath());
+        settings.summaryFile = lma::resolvePath(configPath, config.ensembleSummary());
+        settings.sparse = config.outputResFormat() == "sparse";
+        settings.nWorkers = config.ensembleWorkers() > 0 ? config.ensembleWorkers() : nWorkspaces;
+        settings.queueSize = config.ensembleQueue() > 0 ? config.ensembleQueue() : settings.nWorkers;
+
+        std::cout << "Running " << settings.count << " realizations (" << settings.nWorkers << " workers)... " << std::flush;
+        const double t1 = timer.elapsed();
+        lma::Ensemble ensemble(grid, active.get(), ids, idsTarget, settings);
+        ensemble.setConfigure(configureSolver);
+        ensemble.run();
+        const double t2 = timer.elapsed();
+        std::cout << "OK!" << std::endl;
+        std::cout << "Summary exported to '" << settings.summaryFile << "'" << std::endl;
+
+        delete grid;
+        std::cout << std::endl;
+        std::cout << "Time elapsed = " << timer.elapsed() - tStart << "s (ensemble time = " << t2 - t1 << "s)" << std::endl;
+        std::cout << std::endl;
+        return;
+    }
+
     // Define Lazy Mole object
     std::cout << "Running algorithm... " << std::flush;
-    mla::LazyMole lazyMole(grid, conductivity, ids);
+    std::unique_ptr<mla::LazyMole> lazyMolePtr;
+    std::unique_ptr<mla::Multilevel> multilevel;
+    std::unique_ptr<mla::FlowCorridor> flowCorridor;
+    if (config.hasMultilevel() && config.hasFlowCorridor())
+    {
+        throw std::runtime_error("ERROR: the multilevel and corridor modes cannot be used together");
+    }
+    if (config.hasMultilevel())
+    {
+        multilevel.reset(new mla::Multilevel(grid, conductivity, ids, idsTarget, active.get()));
+        multilevel->setFactor(config.multilevelFactor());
+        multilevel->setAveraging(averagingFromName(config.multilevelAveraging()));
+        multilevel->setCorridorWidth(config.multilevelCorridor());
+        multilevel->setVerify(config.multilevelVerify());
+    }
+    else if (config.hasFlowCorridor())
+    {
+        flowCorridor.reset(new mla::FlowCorridor(grid, conductivity, ids, idsTarget, active.get()));
+        flowCorridor->setTolerance(config.flowCorridorTolerance());
+    }
+    else
+    {
+        lazyMolePtr.reset(new mla::LazyMole(grid, conductivity, ids, active.get()));
+        configureSolver(*lazyMolePtr);
+        lazyMolePtr->setPathAttributes(hasAttributes);
+    }
 
-    // Run Lazy Mole
+    // Field loaded on demand: only the tiles reached by the search are read
+    std::unique_ptr<lma::TileLoader> tileLoader;
+    if (isLazyField)
+    {
+        // The bucket queue is sized from the conductivity bounds and the checkpoint and cache keys
+        // hash the conductivity: none of them are known before the tiles are read
+        if (!lazyMolePtr || config.hasCache() || config.hasCheckpoint() ||
+            config.queue() == "bucket")
+        {
+            throw std::runtime_error("ERROR: a field loaded on demand requires the heap queue, "
+                                     "without multilevel, corridor, cache or checkpoint");
+        }
+        if (!stopAtTargets && maxResistance == std::numeric_limits<double>::max())
+        {
+            std::cerr << "WARNING: the search is not stopped at the targets, all the tiles will be loaded" << std::endl;
+        }
+        tileLoader.reset(new lma::TileLoader(*tileFile, grid, conductivity, log));
+        tileLoader->attach(*lazyMolePtr);
+    }
+
+    // Run Lazy Mole (or load the result of a previous run with the same inputs)
     const double t1 = timer.elapsed();
-    auto smallestRes = lazyMole.run();
+    mla::LazyMole* lazyMole = lazyMolePtr.get();
+    bool isCached = false;
+    if (multilevel)
+    {
+        warnIgnoredSettings(config, "multilevel");
+        lazyMole = &multilevel->run();
+    }
+    else if (flowCorridor)
+    {
+        warnIgnoredSettings(config, "corridor");
+        lazyMole = &flowCorridor->run();
+    }
+    else
+    {
+        const bool hasKey = config.hasCache() || config.hasCheckpoint();
+        const uint64_t key = hasKey ? mla::ResultCache::key(*lazyMole) : 0;
+        std::unique_ptr<mla::ResultCache> cache;
+        if (config.hasCache())
+        {
+            cache.reset(new mla::ResultCache(lma::resolvePath(configPath, config.cacheFile())));
+            isCached = cache->load(key, *lazyMole);
+        }
+        if (!isCached)
+        {
+            if (config.hasCheckpoint())
+            {
+                const std::string checkpointFile = lma::resolvePath(configPath, config.checkpointFile());
+                if (config.checkpointResume() && lazyMole->resume(checkpointFile, key))
+                {
+                    std::cout << "resuming from '" << checkpointFile << "'... " << std::flush;
+                }
+                lazyMole->setCheckpoint(checkpointFile, config.checkpointCells(), config.checkpointSeconds(), key);
+            }
+
+            // Progress lines at most once per second, Ctrl-C (or SIGTERM) stops the run cleanly
+            double lastReport = 0.;
+            if (showProgress)
+            {
+                lazyMole->setProgress([&lastReport](const mla::RunProgress& progress)
+                {
+                    if (progress.elapsed - lastReport < 1.)
+                        return;
+                    std::cerr << (lastReport == 0. ? "\n" : "") << "Progress: " << std::fixed << std::setprecision(1)
+                              << 100. * progress.settled / progress.total << "% of the cells settled, resistance "
+                              << std::defaultfloat << std::setprecision(6) << progress.resistance << ", elapsed "
+                              << std::fixed << std::setprecision(1) << progress.elapsed << "s, ETA "
+                              << progress.eta << "s" << std::defaultfloat << std::setprecision(6) << std::endl;
+                    lastReport = progress.elapsed;
+                });
+            }
+            lazyMole->setCancellation(&isCancelRequested);
+            auto previousInt = std::signal(SIGINT, requestCancel);
+            auto previousTerm = std::signal(SIGTERM, requestCancel);
+            lazyMole->run();
+            std::signal(SIGINT, previousInt);
+            std::signal(SIGTERM, previousTerm);
+            if (lazyMole->cancelled())
+            {
+                throw std::runtime_error(std::string("ERROR: the run was cancelled") +
+                                         (config.hasCheckpoint() ? ", it can be resumed from the checkpoint" : ""));
+            }
+            if (cache)
+            {
+                cache->save(key, *lazyMole);
+            }
+        }
+    }
+    auto smallestRes = lazyMole->resistance();
     const double t2 = timer.elapsed();
     std::cout << "OK!" << std::endl;
+    if (config.hasCache() && lazyMolePtr)
+    {
+        std::cout << (isCached ? "Result loaded from cache '" : "Result saved to cache '")
+                  << lma::resolvePath(configPath, config.cacheFile()) << "'" << std::endl;
+    }
+    if (tileLoader)
+    {
+        std::cout << "Tiles loaded = " << tileLoader->loadedTiles() << " of " << tileFile->numberOfTiles() << std::endl;
+    }
+    if (config.queue() == "bucket" && lazyMolePtr)
+    {
+        std::cout << "Approximate resistances, relative error < " << lazyMole->errorBound() << std::endl;
+    }
+    if (multilevel)
+    {
+        std::cout << "Corridor cells = " << multilevel->corridorSize() << " of " << grid->numberOfCells()
+                  << ", corridor MHR = " << multilevel->corridorResistance() << std::endl;
+    }
+    if (flowCorridor)
+    {
+        std::cout << "Flow corridor cells = " << flowCorridor->size() << " of " << grid->numberOfCells()
+                  << " within " << config.flowCorridorTolerance() << " of the MHR" << std::endl;
+    }
 
-    // Output
-    std::cout << "Exporting resistance map to '" << configPath + config.outputRes() << "'... " << std::flush;
-    smallestRes->exportToFile(configPath + config.outputRes());
+    // Output ('-' is the standard output)
+    if (config.outputResFormat() != "sparse" && config.outputResFormat() != "dense")
+    {
+        throw std::runtime_error("ERROR: unknown resistance format '" + config.outputResFormat() + "' (use 'dense' or 'sparse')");
+    }
+    const std::string resName = lma::resolvePath(configPath, config.outputRes());
+    std::cout << "Exporting resistance map to '" << resName << "'... " << std::flush;
+    if (lma::isSharedMemory(resName))
+    {
+        // One double per cell, in the order of field.dat (largest double for the cells not reached)
+        const size_t nCells = grid->numberOfCells();
+        lma::SharedMemory segment(resName, nCells * sizeof(double));
+        double* values = reinterpret_cast<double*>(segment.data());
+        for (size_t cell = 0; cell < nCells; cell++)
+        {
+            values[cell] = smallestRes->getFromCell(cell);
+        }
+    }
+    else
+    {
+        lma::OutputStream outStream(resName, protocolStream);
+        if (config.outputResFormat() == "sparse")
+        {
+            smallestRes->exportSparseToStream(outStream.get(), std::numeric_limits<double>::max());
+        }
+        else
+        {
+            smallestRes->exportToStream(outStream.get());
+        }
+        outStream.close();
+    }
     std::cout << "OK!" << std::endl;
 
     double minRes = 1e20;
     size_t minId = grid->numberOfCells();
     for (size_t i = 0; i < idsTarget.size(); i++)
     {
-        if (smallestRes->get(idsTarget[i]) < minRes)
+        if (smallestRes->getFromCell(idsTarget[i]) < minRes)
         {
             minId  = idsTarget[i];
-            minRes = smallestRes->get(idsTarget[i]);
+            minRes = smallestRes->getFromCell(idsTarget[i]);
         }
     }
-    std::cout << "Minimum Hydraulic Resistance = " << minRes << std::endl;
-    std::cout << "Target ID = " << minId << std::endl;
+    if (minId == grid->numberOfCells())
+    {
+        std::cerr << "WARNING: no target cell has been reached, the least resistance path is not exported" << std::endl;
+    }
+    else
+    {
+        std::cout << "Minimum Hydraulic Resistance = " << minRes << std::endl;
+        std::cout << "Target ID = " << minId << std::endl;
 
-    std::cout << "Exporting least resistance path to '" << configPath + config.outputPath() << "'... " << std::flush;
-    lazyMole.exportPath(minId, configPath + config.outputPath());
-    std::cout << "OK!" << std::endl;
+        std::cout << "Exporting least resistance path to '" << lma::resolvePath(configPath, config.outputPath()) << "'... " << std::flush;
+        lma::OutputStream outStream(lma::resolvePath(configPath, config.outputPath()), protocolStream);
+        lazyMole->exportPath(minId, outStream.get());
+        outStream.close();
+        std::cout << "OK!" << std::endl;
+    }
+
+    if (config.hasOutputPaths())
+    {
+        std::cout << "Exporting least resistance paths of all the targets to '" << lma::resolvePath(configPath, config.outputPaths()) << "'... " << std::flush;
+        lma::OutputStream outStream(lma::resolvePath(configPath, config.outputPaths()), protocolStream);
+        lazyMole->exportPathTree(idsTarget, outStream.get());
+        outStream.close();
+        std::cout << "OK!" << std::endl;
+    }
+
+    if (config.hasOutputSensitivity())
+    {
+        std::vector<size_t> sensitivityIds;
+        if (config.outputSensitivityTargets() == "all")
+        {
+            sensitivityIds = idsTarget;
+        }
+        else if (config.outputSensitivityTargets() == "best")
+        {
+            if (minId != grid->numberOfCells())
+                sensitivityIds.push_back(minId);
+        }
+        else
+        {
+            throw std::runtime_error("ERROR: unknown sensitivity targets '" + config.outputSensitivityTargets() + "' (use 'best' or 'all')");
+        }
+
+        std::cout << "Exporting sensitivity to '" << lma::resolvePath(configPath, config.outputSensitivity()) << "'... " << std::flush;
+        auto gradient = lazyMole->sensitivity(sensitivityIds);
+        if (config.outputSensitivityLog())
+        {
+            // dR/dlogK = K dR/dK
+            for (size_t id = 0; id < gradient.dof(); id++)
+            {
+                gradient[id] *= conductivity.getFromCell(lazyMole->activeCells()->cell(id));
+            }
+        }
+        lma::OutputStream outStream(lma::resolvePath(configPath, config.outputSensitivity()), protocolStream);
+        if (config.outputResFormat() == "sparse")
+        {
+            gradient.exportSparseToStream(outStream.get(), 0.);
+        }
+        else
+        {
+            gradient.exportToStream(outStream.get());
+        }
+        outStream.close();
+        std::cout << "OK!" << std::endl;
+    }
+
+    if (flowCorridor)
+    {
+        std::cout << "Exporting flow corridor to '" << lma::resolvePath(configPath, config.outputCorridorMask()) << "' and '"
+                  << lma::resolvePath(configPath, config.outputCorridorSlack()) << "'... " << std::flush;
+        lma::OutputStream maskStream(lma::resolvePath(configPath, config.outputCorridorMask()), protocolStream);
+        lma::OutputStream slackStream(lma::resolvePath(configPath, config.outputCorridorSlack()), protocolStream);
+        if (config.outputResFormat() == "sparse")
+        {
+            flowCorridor->mask().exportSparseToStream(maskStream.get(), 0);
+            flowCorridor->slack().exportSparseToStream(slackStream.get(), std::numeric_limits<double>::max());
+        }
+        else
+        {
+            flowCorridor->mask().exportToStream(maskStream.get());
+            flowCorridor->slack().exportToStream(slackStream.get());
+        }
+        maskStream.close();
+        slackStream.close();
+        std::cout << "OK!" << std::endl;
+    }
+
+    if (hasAttributes)
+    {
+        // Length, number of steps and smallest/largest conductivity along the least resistance path of each cell
+        for (auto& name : attributeNames)
+        {
+            if (!config.hasOutputAttribute(name))
+            {
+                continue;
+            }
+            std::cout << "Exporting path " << name << " to '" << lma::resolvePath(configPath, config.outputAttribute(name)) << "'... " << std::flush;
+            lma::OutputStream outStream(lma::resolvePath(configPath, config.outputAttribute(name)), protocolStream);
+            if (name == "steps")
+            {
+                if (config.outputResFormat() == "sparse")
+                {
+                    lazyMole->pathSteps().exportSparseToStream(outStream.get(), std::numeric_limits<size_t>::max());
+                }
+                else
+                {
+                    lazyMole->pathSteps().exportToStream(outStream.get());
+                }
+            }
+            else
+            {
+                const auto& values = name == "length" ? lazyMole->pathLength() :
+                                     name == "minK" ? lazyMole->pathMinConductivity() : lazyMole->pathMaxConductivity();
+                if (config.outputResFormat() == "sparse")
+                {
+                    values.exportSparseToStream(outStream.get(), std::numeric_limits<double>::max());
+                }
+                else
+                {
+                    values.exportToStream(outStream.get());
+                }
+            }
+            outStream.close();
+            std::cout << "OK!" << std::endl;
+        }
+    }
+
+    if (config.hasOutputLabels() || config.hasOutputLabelTargets())
+    {
+        auto labels = lazyMole->sourceLabels();
+        if (config.hasOutputLabels())
+        {
+            std::cout << "Exporting source labels to '" << lma::resolvePath(configPath, config.outputLabels()) << "'... " << std::flush;
+            lma::OutputStream outStream(lma::resolvePath(configPath, config.outputLabels()), protocolStream);
+            if (config.outputResFormat() == "sparse")
+            {
+                labels.exportSparseToStream(outStream.get(), std::numeric_limits<size_t>::max());
+            }
+            else
+            {
+                labels.exportToStream(outStream.get());
+            }
+            outStream.close();
+            std::cout << "OK!" << std::endl;
+        }
+        if (config.hasOutputLabelTargets())
+        {
+            std::cout << "Exporting best source of each target to '" << lma::resolvePath(configPath, config.outputLabelTargets()) << "'... " << std::flush;
+            lma::OutputStream outStream(lma::resolvePath(configPath, config.outputLabelTargets()), protocolStream);
+            for (auto id : idsTarget)
+            {
+                outStream.get() << id << " " << labels.getFromCell(id) << " " << smallestRes->getFromCell(id) << '\n';
+            }
+            outStream.close();
+            std::cout << "OK!" << std::endl;
+        }
+    }
 
     // Free space
     delete grid;